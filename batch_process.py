@@ -0,0 +1,261 @@
+#!/usr/bin/env python3
+"""
+Headless batch analysis of a directory of EEG recordings.
+
+Every recording (data/eeg_*.csv or .eegrec; when both exist for the same
+session the binary copy is used) is processed on a pool of worker
+processes, one file per task:
+
+    - the same notch + bandpass stage as the live GUI (--no-filter to skip)
+    - features of sliding --window-seconds windows every --step-seconds
+    - class probabilities from the saved model (flattened forest or pickle)
+
+All windows of all files go into one Parquet table (one row per window:
+file, start/end time, the feature vector, probabilities and predicted
+class), and a per-file summary is printed. Rows carry the SHA-256 of
+their recording and of the processing config (model file included), so
+a rerun only reprocesses recordings that are new or have changed:
+
+    python batch_process.py data --out results/batch.parquet
+"""
+
+from __future__ import annotations
+
+import argparse
+import glob
+import hashlib
+import json
+import os
+import sys
+from concurrent.futures import ProcessPoolExecutor
+from typing import Any, Dict, List, Optional, Tuple
+
+import numpy as np
+import pandas as pd
+
+from eeg_features import BANDS, N_FEATURES, extract_features_batch, extract_features_multichannel
+from eeg_filters import BANDPASS_HZ, MAINS_HZ, filter_signal
+from eeg_forest import FOREST_PATH, FlatForest
+from eeg_hashing import file_sha256
+from eeg_recording import BINARY_EXT, open_recording
+
+
+DATA_DIR = "data"
+RESULTS_PATH = os.path.join("results", "batch.parquet")
+FILE_PATTERN = "eeg_*"
+CHUNK_WINDOWS = 2048  # windows featurized per step within one file
+# Same path as train_classifier.MODEL_PATH; used when there is no flat forest
+MODEL_PATH = os.path.join("models", "eeg_state_model.pkl")
+# Same labels as eeg_gui.CLASS_NAMES (importing it would pull in Qt)
+CLASS_NAMES = {0: "Relaxed", 1: "Focused", 2: "Sleepy"}
+FEATURE_NAMES = ["mean", "std", "min", "max", "ptp"] + [f"{name}_power" for name, _ in BANDS]
+
+_model: Any = None  # loaded once per worker process
+
+
+def find_recordings(directory: str, pattern: str = FILE_PATTERN) -> List[str]:
+    """Recordings under `directory`, preferring .eegrec over a same-named CSV."""
+    by_stem: Dict[str, str] = {}
+    for path in sorted(glob.glob(os.path.join(directory, pattern))):
+        stem, ext = os.path.splitext(path)
+        if ext not in (".csv", BINARY_EXT):
+            continue
+        if ext == BINARY_EXT or stem not in by_stem:
+            by_stem[stem] = path
+    return sorted(by_stem.values())
+
+
+def _load_model(path: str) -> Any:
+    if path.endswith(".npz"):
+        return FlatForest.load(path)
+    import joblib
+
+    return joblib.load(path)
+
+
+def _init_worker(model_path: str) -> None:
+    global _model
+    _model = _load_model(model_path)
+
+
+def _feature_columns(channels: int) -> List[str]:
+    if channels == 1:
+        return list(FEATURE_NAMES)
+    return [f"ch{c}_{name}" for c in range(channels) for name in FEATURE_NAMES]
+
+
+def process_recording(
+    path: str,
+    window_seconds: float,
+    step_seconds: float,
+    filtered: bool,
+) -> Optional[pd.DataFrame]:
+    """Per-window features and predictions for one recording (worker side)."""
+    rec = open_recording(path)
+    window = int(window_seconds * rec.fs)
+    step = max(int(step_seconds * rec.fs), 1)
+    if len(rec) < window:
+        return None
+
+    volts = np.asarray(rec.voltage, dtype=float)
+    if filtered:
+        volts = filter_signal(volts, rec.fs, axis=0)
+    starts = np.arange(0, len(rec) - window + 1, step)
+
+    # Strided views, featurized CHUNK_WINDOWS at a time, so overlapping
+    # windows are only ever copied out one chunk at a time
+    segments = np.lib.stride_tricks.sliding_window_view(volts, window, axis=0)[::step]
+    X = np.zeros((starts.size, rec.channels * N_FEATURES), dtype=float)
+    for i in range(0, starts.size, CHUNK_WINDOWS):
+        chunk = segments[i : i + CHUNK_WINDOWS]
+        if volts.ndim == 1:
+            X[i : i + CHUNK_WINDOWS] = extract_features_batch(chunk, fs=rec.fs)
+        else:
+            X[i : i + CHUNK_WINDOWS] = extract_features_multichannel(chunk, fs=rec.fs)
+
+    proba = np.asarray(_model.predict_proba(X))
+    classes = np.asarray(_model.classes_)
+
+    df = pd.DataFrame(X, columns=_feature_columns(rec.channels))
+    df.insert(0, "start_s", starts / rec.fs)
+    df.insert(1, "end_s", (starts + window) / rec.fs)
+    for i, cls in enumerate(classes):
+        df[f"p_{CLASS_NAMES.get(int(cls), str(cls)).lower()}"] = proba[:, i]
+    df["state"] = classes[np.argmax(proba, axis=1)].astype(int)
+    return df
+
+
+def _config_hash(args: argparse.Namespace) -> str:
+    """Everything besides the file contents that changes the results."""
+    config = {
+        "window_seconds": args.window_seconds,
+        "step_seconds": args.step_seconds,
+        "filter": None if args.no_filter else {"mains": MAINS_HZ, "band": list(BANDPASS_HZ)},
+        "bands": [list(band) for _name, band in BANDS],
+        "n_features": N_FEATURES,
+        "model": file_sha256(args.model),
+    }
+    return hashlib.sha256(json.dumps(config, sort_keys=True).encode()).hexdigest()[:20]
+
+
+def _load_previous(path: str) -> pd.DataFrame:
+    if not os.path.exists(path):
+        return pd.DataFrame()
+    try:
+        return pd.read_parquet(path)
+    except (OSError, ValueError) as exc:
+        print(f"[WARN] Ignoring unreadable results file {path}: {exc}", file=sys.stderr)
+        return pd.DataFrame()
+
+
+def summarize(results: pd.DataFrame) -> pd.DataFrame:
+    """Per-file window count, duration, state shares and signal level."""
+    groups = results.groupby("file", sort=True)
+    summary = pd.DataFrame(
+        {
+            "windows": groups.size(),
+            "seconds": groups["end_s"].max(),
+            "dominant": groups["state"].agg(lambda s: CLASS_NAMES.get(int(s.mode().iloc[0]), "?")),
+        }
+    )
+    for cls, name in CLASS_NAMES.items():
+        summary[f"%{name.lower()}"] = groups["state"].agg(lambda s, c=cls: 100.0 * (s == c).mean())
+    std_col = "std" if "std" in results else [c for c in results if c.endswith("_std")][0]
+    summary["mean_std_v"] = groups[std_col].mean()
+    return summary
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(
+        description="Featurize and classify a directory of EEG recordings in parallel."
+    )
+    parser.add_argument("directory", nargs="?", default=DATA_DIR)
+    parser.add_argument("--pattern", default=FILE_PATTERN, help="Recording file glob.")
+    parser.add_argument("--out", default=RESULTS_PATH, help="Parquet results file.")
+    parser.add_argument(
+        "--model",
+        help=f"Flattened forest (.npz) or pickle (default: {FOREST_PATH}, else {MODEL_PATH}).",
+    )
+    parser.add_argument("--window-seconds", type=float, default=3.0)
+    parser.add_argument("--step-seconds", type=float, default=0.25)
+    parser.add_argument("--no-filter", action="store_true", help="Skip the notch + bandpass stage.")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count() or 1, help="Worker processes.")
+    parser.add_argument("--force", action="store_true", help="Reprocess every file.")
+    args = parser.parse_args()
+
+    if args.model is None:
+        # A search that picked a non-forest model leaves only the pickle
+        args.model = FOREST_PATH if os.path.exists(FOREST_PATH) else MODEL_PATH
+    if not os.path.exists(args.model):
+        raise SystemExit(f"[ERROR] No model at {args.model}; run train_classifier.py first")
+    paths = find_recordings(args.directory, args.pattern)
+    if not paths:
+        raise SystemExit(f"[ERROR] No recordings matching {args.pattern} in {args.directory}")
+
+    config_hash = _config_hash(args)
+    previous = pd.DataFrame() if args.force else _load_previous(args.out)
+    known: Dict[Tuple[str, str], pd.DataFrame] = {}
+    if not previous.empty:
+        current = previous[previous["config_hash"] == config_hash]
+        for (name, digest), rows in current.groupby(["file", "content_hash"], sort=False):
+            known[(name, digest)] = rows
+
+    parts: List[pd.DataFrame] = []
+    with ProcessPoolExecutor(
+        max_workers=max(args.jobs, 1), initializer=_init_worker, initargs=(args.model,)
+    ) as pool:
+        digests = list(pool.map(file_sha256, paths))
+        todo = []
+        for path, digest in zip(paths, digests):
+            rows = known.get((os.path.basename(path), digest))
+            if rows is not None:
+                parts.append(rows)
+            else:
+                todo.append((path, digest))
+        print(
+            f"[INFO] {len(paths)} recordings: {len(paths) - len(todo)} unchanged, "
+            f"{len(todo)} to process on {args.jobs} workers"
+        )
+
+        futures = [
+            (path, digest, pool.submit(
+                process_recording, path, args.window_seconds, args.step_seconds, not args.no_filter
+            ))
+            for path, digest in todo
+        ]
+        for path, digest, future in futures:
+            try:
+                df = future.result()
+            except Exception as exc:  # one bad file must not lose the others
+                print(f"[ERROR] Could not process {path}: {exc!r}", file=sys.stderr)
+                continue
+            if df is None:
+                print(f"[WARN] {path} is shorter than one window, skipped")
+                continue
+            df.insert(0, "file", os.path.basename(path))
+            df.insert(1, "content_hash", digest)
+            df.insert(2, "config_hash", config_hash)
+            parts.append(df)
+            print(f"[INFO] {path}: {len(df)} windows")
+
+    if not parts:
+        raise SystemExit("[ERROR] No windows produced")
+    results = pd.concat(parts, ignore_index=True)
+
+    # Write then rename so an interrupted run keeps the old results
+    os.makedirs(os.path.dirname(args.out) or ".", exist_ok=True)
+    tmp = args.out + ".tmp"
+    results.to_parquet(tmp, index=False)
+    os.replace(tmp, args.out)
+    n_files = results["file"].nunique()
+    print(f"[INFO] Wrote {len(results)} windows from {n_files} files to {args.out}")
+
+    with pd.option_context("display.width", 120, "display.max_rows", None):
+        print(summarize(results).round(2).to_string())
+
+
+__all__ = ["find_recordings", "process_recording", "summarize", "FEATURE_NAMES"]
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,324 @@
+#!/usr/bin/env python3
+"""
+Benchmarks for the feature, parsing, inference and loading hot paths.
+
+Uses a recording from data/ (the largest eeg_*.csv by default) as the
+fixture, so the numbers reflect real signal rather than synthetic noise.
+Each benchmark is timed with timeit (best of several repeats) and
+reported as time per operation and operations per second.
+
+Save a baseline, then compare later commits against it; the script
+exits non-zero when any benchmark is slower than the tolerance allows:
+    python benchmark.py --save bench/baseline.json
+    python benchmark.py --compare bench/baseline.json --tolerance 0.25
+
+Select benchmarks by name prefix with --only, e.g. --only features.
+"""
+
+from __future__ import annotations
+
+import argparse
+import glob
+import json
+import os
+import sys
+import tempfile
+import timeit
+from typing import Callable, Dict, List, Optional, Tuple
+
+import numpy as np
+
+from eeg_features import (
+    DEFAULT_FS,
+    IncrementalFeatures,
+    _bandpower,
+    _features_2d_numpy,
+    eeg_native,
+    extract_features,
+    extract_features_batch,
+)
+from eeg_forest import flatten_forest
+from eeg_protocol import FrameDecoder, FrameFormat, encode_frames
+from eeg_recording import Recording, open_recording, write_recording
+
+
+DATA_GLOB = os.path.join("data", "eeg_*.csv")
+WINDOW_LENGTHS = (100, 300, 1000, 3000)
+DATASET_ROWS = 2000
+DATASET_WINDOW = 300
+REPEATS = 5
+
+# name -> (seconds per op, ops per benchmark call, unit)
+Result = Tuple[float, int, str]
+
+
+def _time(fn: Callable[[], object], repeats: int = REPEATS) -> float:
+    """Best wall time of one fn() call over `repeats` autoranged runs."""
+    timer = timeit.Timer(fn)
+    number, _ = timer.autorange()
+    return min(timer.repeat(repeat=repeats, number=number)) / number
+
+
+def _fixture_signal(path: Optional[str]) -> Tuple[str, np.ndarray]:
+    if path is None:
+        candidates = sorted(glob.glob(DATA_GLOB), key=os.path.getsize)
+        if not candidates:
+            raise SystemExit(f"[ERROR] No recordings matching {DATA_GLOB}; pass --data")
+        path = candidates[-1]
+    rec = open_recording(path)
+    volts = np.asarray(rec.voltage, dtype=float)
+    if volts.ndim == 2:
+        volts = volts[:, 0]
+    if volts.size < max(WINDOW_LENGTHS):
+        raise SystemExit(f"[ERROR] {path} is too short for the benchmarks")
+    return path, volts
+
+
+def _tiled(signal: np.ndarray, n: int) -> np.ndarray:
+    reps = -(-n // signal.size)
+    return np.tile(signal, reps)[:n]
+
+
+# ---------------- benchmarks ----------------
+def bench_parse(signal: np.ndarray, results: Dict[str, Result]) -> None:
+    try:
+        from eeg_gui import SerialReader
+    except ImportError as exc:
+        print(f"[WARN] Skipping text parser benchmark: {exc}", file=sys.stderr)
+        return
+    raw = np.round(signal / (4.096 / 32768.0)).astype(int)
+    lines = [f"Raw: {r}\tVoltage: {v:.2f}" for r, v in zip(raw[:2000], signal[:2000])]
+    parse = SerialReader._parse_line
+
+    def run() -> None:
+        for line in lines:
+            parse(line)
+
+    results["parse.text_lines"] = (_time(run) / len(lines), len(lines), "line")
+
+
+def bench_binary_decode(signal: np.ndarray, results: Dict[str, Result]) -> None:
+    fmt = FrameFormat()
+    codes = np.round(_tiled(signal, 8000) / (4.096 / 32768.0)).astype(np.int16)
+    stream = encode_frames(codes[:, None], fmt)
+    n = (len(stream) // fmt.size) * fmt.samples
+
+    def run() -> None:
+        FrameDecoder(fmt).feed(stream)
+
+    results["parse.binary_samples"] = (_time(run) / n, n, "sample")
+
+
+def _baseline_extract(signal: np.ndarray, fs: float = DEFAULT_FS) -> np.ndarray:
+    """The original extract_features: list copy, stats, one FFT per band."""
+    x = np.asarray(list(signal), dtype=float)
+    xmin = float(np.min(x))
+    xmax = float(np.max(x))
+    bands = ((0.5, 4.0), (4.0, 8.0), (8.0, 13.0), (13.0, 30.0))
+    powers = [_bandpower(x, fs, band) for band in bands]
+    stats = [float(np.mean(x)), float(np.std(x)), xmin, xmax, xmax - xmin]
+    return np.array(stats + powers, dtype=float)
+
+
+def bench_features(signal: np.ndarray, results: Dict[str, Result]) -> None:
+    # extract_features takes the native engine when it is built
+    for n in WINDOW_LENGTHS:
+        window = np.ascontiguousarray(signal[:n])
+        results[f"features.extract_{n}"] = (_time(lambda: extract_features(window)), 1, "window")
+
+    window = np.ascontiguousarray(signal[:DATASET_WINDOW])
+    baseline = _time(lambda: _baseline_extract(window))
+    results[f"features.baseline_extract_{DATASET_WINDOW}"] = (baseline, 1, "window")
+    rows = window[None, :]
+    out = np.zeros((1, extract_features(window).size))
+    results[f"features.numpy_extract_{DATASET_WINDOW}"] = (
+        _time(lambda: _features_2d_numpy(rows, DEFAULT_FS, out)),
+        1,
+        "window",
+    )
+    current = results[f"features.extract_{DATASET_WINDOW}"][0]
+    engine = "native" if eeg_native is not None else "numpy"
+    print(
+        f"[INFO] extract_features ({engine}) on {DATASET_WINDOW} samples: "
+        f"{baseline / current:.1f}x the original implementation"
+    )
+
+    # Live path: one 8-sample block pushed per tick, then features()
+    inc = IncrementalFeatures(DATASET_WINDOW, DEFAULT_FS)
+    inc.push(signal[:DATASET_WINDOW])
+    block = signal[DATASET_WINDOW : DATASET_WINDOW + 8]
+
+    def tick() -> None:
+        inc.push(block)
+        inc.features()
+
+    results[f"features.incremental_{DATASET_WINDOW}"] = (_time(tick), 1, "tick")
+
+
+def _dataset(signal: np.ndarray) -> Tuple[np.ndarray, np.ndarray]:
+    long = _tiled(signal, DATASET_ROWS * DATASET_WINDOW)
+    X_raw = long.reshape(DATASET_ROWS, DATASET_WINDOW)
+    y = np.arange(DATASET_ROWS) % 3
+    return X_raw, y
+
+
+def bench_dataset(signal: np.ndarray, results: Dict[str, Result], tmp: str) -> None:
+    X_raw, y = _dataset(signal)
+    results["dataset.featurize_rows"] = (
+        _time(lambda: extract_features_batch(X_raw), repeats=3) / DATASET_ROWS,
+        DATASET_ROWS,
+        "row",
+    )
+
+    try:
+        import pandas as pd
+
+        from train_classifier import load_dataset
+    except ImportError as exc:
+        print(f"[WARN] Skipping load_dataset benchmark: {exc}", file=sys.stderr)
+        return
+    path = os.path.join(tmp, "dataset.csv")
+    df = pd.DataFrame(X_raw, columns=[f"voltage_{i}" for i in range(DATASET_WINDOW)])
+    df["label"] = y
+    df.to_csv(path, index=False)
+    results["dataset.load_dataset_rows"] = (
+        _time(lambda: load_dataset(path), repeats=3) / DATASET_ROWS,
+        DATASET_ROWS,
+        "row",
+    )
+
+
+def bench_predict(signal: np.ndarray, results: Dict[str, Result]) -> None:
+    try:
+        from sklearn.ensemble import RandomForestClassifier
+    except ImportError as exc:
+        print(f"[WARN] Skipping model benchmarks: {exc}", file=sys.stderr)
+        return
+    X_raw, y = _dataset(signal)
+    X = extract_features_batch(X_raw)
+    # Same shape of model as train_classifier, on fixed labels
+    clf = RandomForestClassifier(n_estimators=200, random_state=42, n_jobs=1).fit(X, y)
+    forest = flatten_forest(clf)
+    one = X[:1]
+    batch = X[:256]
+
+    results["predict.sklearn_single"] = (_time(lambda: clf.predict_proba(one)), 1, "window")
+    # flat_* take the native evaluator when it is built
+    results["predict.flat_single"] = (_time(lambda: forest.predict_proba(one)), 1, "window")
+    one32 = one.astype(np.float32)
+    results["predict.flat_numpy_single"] = (
+        _time(lambda: forest._predict_proba_numpy(one32)),
+        1,
+        "window",
+    )
+    results["predict.flat_batch_256"] = (
+        _time(lambda: forest.predict_proba(batch)) / batch.shape[0],
+        batch.shape[0],
+        "window",
+    )
+    sklearn = results["predict.sklearn_single"][0]
+    flat = results["predict.flat_single"][0]
+    engine = "native" if forest._native is not None else "numpy"
+    print(
+        f"[INFO] Single-window predict_proba ({engine}): {flat * 1e6:.1f} us "
+        f"vs sklearn {sklearn * 1e6:.1f} us"
+    )
+
+
+def bench_load(csv_path: str, results: Dict[str, Result], tmp: str) -> None:
+    rec = open_recording(csv_path)
+    bin_path = os.path.join(tmp, "fixture.eegrec")
+    write_recording(bin_path, rec)
+    n = len(rec)
+
+    def load(path: str) -> Callable[[], object]:
+        def run() -> object:
+            loaded: Recording = open_recording(path)
+            # Touch every voltage so lazy memmaps pay their I/O too
+            return float(np.asarray(loaded.voltage, dtype=float).sum())
+
+        return run
+
+    results["load.csv"] = (_time(load(csv_path), repeats=3) / n, n, "sample")
+    results["load.binary"] = (_time(load(bin_path), repeats=3) / n, n, "sample")
+
+
+# ---------------- reporting ----------------
+def _report(results: Dict[str, Result]) -> None:
+    width = max(len(name) for name in results)
+    for name, (seconds, _n, unit) in sorted(results.items()):
+        print(f"{name:<{width}}  {seconds * 1e6:12.3f} us/{unit:<7} {1.0 / seconds:14.0f} {unit}s/s")
+
+
+def _compare(results: Dict[str, Result], baseline_path: str, tolerance: float) -> List[str]:
+    with open(baseline_path, "r", encoding="utf-8") as f:
+        baseline = json.load(f)
+    regressions = []
+    for name, (seconds, _n, _unit) in sorted(results.items()):
+        if name not in baseline:
+            continue
+        ratio = seconds / baseline[name]["seconds"]
+        marker = "REGRESSION" if ratio > 1.0 + tolerance else ""
+        print(f"{name:<32} {ratio:6.2f}x baseline {marker}")
+        if marker:
+            regressions.append(name)
+    return regressions
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Benchmark the EEG pipeline hot paths.")
+    parser.add_argument("--data", help=f"Fixture recording (default: largest {DATA_GLOB}).")
+    parser.add_argument("--only", help="Run only benchmarks whose name starts with this.")
+    parser.add_argument("--save", metavar="JSON", help="Write results as a baseline file.")
+    parser.add_argument("--compare", metavar="JSON", help="Compare against a baseline file.")
+    parser.add_argument(
+        "--tolerance",
+        type=float,
+        default=0.25,
+        help="Allowed slowdown vs. baseline before failing (0.25 = 25%%).",
+    )
+    args = parser.parse_args()
+
+    csv_path, signal = _fixture_signal(args.data)
+    print(f"[INFO] Fixture: {csv_path} ({signal.size} samples)")
+
+    results: Dict[str, Result] = {}
+    with tempfile.TemporaryDirectory() as tmp:
+        suites: List[Tuple[str, Callable[[], None]]] = [
+            ("parse", lambda: (bench_parse(signal, results), bench_binary_decode(signal, results))),
+            ("features", lambda: bench_features(signal, results)),
+            ("dataset", lambda: bench_dataset(signal, results, tmp)),
+            ("predict", lambda: bench_predict(signal, results)),
+            ("load", lambda: bench_load(csv_path, results, tmp)),
+        ]
+        for prefix, run in suites:
+            if args.only and not (prefix.startswith(args.only) or args.only.startswith(prefix)):
+                continue
+            run()
+    if args.only:
+        results = {k: v for k, v in results.items() if k.startswith(args.only)}
+
+    if not results:
+        raise SystemExit("[ERROR] No benchmarks ran")
+    _report(results)
+
+    if args.save:
+        os.makedirs(os.path.dirname(args.save) or ".", exist_ok=True)
+        with open(args.save, "w", encoding="utf-8") as f:
+            json.dump(
+                {name: {"seconds": s, "n": n, "unit": u} for name, (s, n, u) in results.items()},
+                f,
+                indent=2,
+                sort_keys=True,
+            )
+        print(f"[INFO] Saved baseline to {args.save}")
+
+    if args.compare:
+        regressions = _compare(results, args.compare, args.tolerance)
+        if regressions:
+            print(f"[ERROR] {len(regressions)} benchmark(s) regressed", file=sys.stderr)
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
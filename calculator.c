@@ -1,5 +1,16 @@
 #include <REGX52.H>
 
+// Build modes (define in the Keil target, e.g. C51 DEFINE(EEG_FRONTEND)):
+//   default         4-function calculator
+//   EEG_FRONTEND    EEG acquisition front-end: timer-scheduled ADC
+//                   sampling streamed to the host as binary frames
+//   EEG_EDGE        front-end sampling classified on the board by the
+//                   forest tables in edge_model.h (made by eeg_edge.py);
+//                   the LCD shows the state, the host only gets changes
+#ifdef EEG_EDGE
+#define EEG_FRONTEND
+#endif
+
 // ================= LCD ===================
 #define LCD_DATA P0
 
@@ -20,47 +31,386 @@ sbit R2 = P3^1;   // B
 sbit R3 = P3^0;   // C
 sbit R4 = P3^3;   // D
 
+#ifdef EEG_FRONTEND
+// ================= ADC (EEG_FRONTEND) ===
+// MAX197 12-bit ADC: D0..D7 on P1 (HBEN selects the high nibble),
+// strobes on P2.3..P2.6. Its bipolar ranges are the gain settings.
+#define ADC_BUS P1
+
+sbit ADC_CS   = P2^3;
+sbit ADC_WR   = P2^4;
+sbit ADC_RD   = P2^5;
+sbit ADC_HBEN = P2^6;
+#endif
+
 // ================= GLOBAL ERROR FLAG =================
 // (Solves Keil issue: no &bit, no *err pointers)
 unsigned char error_flag = 0;
 
-// ================= DELAY =================
+// ================= TIMEBASE / IDLE =======
+// Delays count hardware timer ticks (see timer0_isr) instead of spinning
+// a calibrated loop, and the CPU sits in IDL mode while it waits: any
+// interrupt (the timer tick included) wakes it immediately.
+#define TICKS_PER_MS  5             // 5 x ~200 us timer-0 ticks
+#define PCON_IDL      0x01
+
+volatile unsigned int tick_ms = 0;  // written by the ISR only
+unsigned char tick_div = 0;         // ~200 us ticks into the current ms
+#ifndef EEG_FRONTEND
+unsigned char tick_step = TICKS_PER_MS; // ~200 us ticks in the running period
+#endif
+
+#define cpu_idle() (PCON |= PCON_IDL)
+
+unsigned int millis(void)
+{
+    unsigned int t;
+    do { t = tick_ms; } while(t != tick_ms);    // 16-bit read is not atomic
+    return t;
+}
+
+// Waits at least `ms` milliseconds (requires timer0_init)
 void delay_ms(unsigned int ms)
 {
-    unsigned int i, j;
-    for(i = 0; i < ms; i++)
-        for(j = 0; j < 123; j++);   // approx @11.0592MHz
+    unsigned int start;
+    start = millis();
+    while((unsigned int)(millis() - start) <= ms) cpu_idle();
 }
 
-// ================= LCD FUNCTIONS =========
-void lcd_pulse(void)
+// ================= LCD OUTPUT QUEUE ======
+// lcd_cmd / lcd_data only enqueue bytes; lcd_tick (from the timer-0 ISR)
+// clocks them out one per tick as soon as the HD44780 busy flag (D7, read
+// back via RW) clears, so callers never wait for the LCD.
+#define LCD_Q_SIZE  32              // power of two
+#define LCD_Q_MASK  (LCD_Q_SIZE - 1)
+#define LCD_Q_CMD   0xFE            // marker: next queued byte is a command
+
+#ifdef EEG_FRONTEND
+// Timer 0, mode 2 (8-bit auto-reload): 184 cycles = ~200 us @11.0592MHz.
+// adc_tick needs this fixed tick for its sample instants.
+#define T0_RELOAD   (256 - 184)
+#else
+// Timer 0, mode 1 (16-bit, re-armed by the ISR): fast 184-cycle (~200 us)
+// ticks only while the LCD queue holds bytes, else 920-cycle (~1 ms)
+// ticks, so the idle calculator wakes 1000 rather than 5000 times a second
+// (a byte queued in a slow period waits at most ~1 ms to go out)
+#define T0_FAST     184
+#define T0_SLOW     (TICKS_PER_MS * T0_FAST)
+#endif
+
+unsigned char idata lcd_q[LCD_Q_SIZE];
+volatile unsigned char lcd_q_head = 0;   // written by main only
+volatile unsigned char lcd_q_tail = 0;   // written by the ISR only
+
+// Free slots in the queue (one slot is always kept empty)
+#define LCD_Q_FREE() ((unsigned char)(lcd_q_tail - lcd_q_head - 1) & LCD_Q_MASK)
+
+void lcd_tick(void)     // ISR only
 {
+    unsigned char t, b;
+
+    t = lcd_q_tail;
+    if(t == lcd_q_head) return;
+
+    // Read busy flag: RS=0, RW=1, D7 high = still executing
+    LCD_DATA = 0xFF;
+    RS = 0;
+    RW = 1;
     EN = 1;
-    delay_ms(2);
+    b = LCD_DATA;
     EN = 0;
-    delay_ms(2);
+    if(b & 0x80) return;
+
+    b = lcd_q[t];
+    if(b == LCD_Q_CMD)
+    {
+        t = (t + 1) & LCD_Q_MASK;
+        b = lcd_q[t];
+        RS = 0;
+    }
+    else
+    {
+        RS = 1;
+    }
+    RW = 0;
+    LCD_DATA = b;
+    EN = 1;
+    EN = 0;
+    lcd_q_tail = (t + 1) & LCD_Q_MASK;
 }
 
-void lcd_cmd(unsigned char cmd)
+// ================= KEYPAD SCANNER ========
+// keypad_tick (from the timer-0 ISR, once per ms) scans one column. Every
+// key has its own debounce integrator, so several keys can be held at
+// once (n-key rollover, up to the ghosting limits of a diode-less
+// matrix); completed presses and auto-repeats go into a FIFO that main
+// drains with keypad_getkey. EEG_FRONTEND has no auto-repeat: its keys
+// step the sample rate and gain, which the host profile must follow.
+#define KEY_DEBOUNCE      5     // stable samples, one per 4 ms sweep (~20 ms)
+#define KEY_REPEAT_DELAY  125   // sweeps before auto-repeat (~500 ms)
+#define KEY_REPEAT_RATE   25    // sweeps between repeats (~100 ms)
+#define KEY_DOWN          0x80  // key_cnt flag: debounced state is pressed
+#define KEY_NONE          0xFF
+#define KEY_Q_SIZE        8     // power of two
+#define KEY_Q_MASK        (KEY_Q_SIZE - 1)
+
+// Column-major: index = col * 4 + row, rows R1..R4 = A..D
+unsigned char code key_map[16] = {
+    '7', '4', '1', 'C',
+    '8', '5', '2', '0',
+    '9', '6', '3', '=',
+    '/', '*', '-', '+'
+};
+
+unsigned char idata key_cnt[16];        // integrator 0..KEY_DEBOUNCE | KEY_DOWN
+unsigned char idata key_q[KEY_Q_SIZE];
+volatile unsigned char key_q_head = 0;  // written by the ISR only
+volatile unsigned char key_q_tail = 0;  // written by main only
+unsigned char key_col = 0;              // column currently driven low
+unsigned char key_repeat_idx = KEY_NONE;
+unsigned char key_repeat_timer = 0;
+
+void key_push(unsigned char k)          // ISR only
 {
-    RS = 0;
-    RW = 0;
-    LCD_DATA = cmd;
-    lcd_pulse();
+    unsigned char h, next;
+    h = key_q_head;
+    next = (h + 1) & KEY_Q_MASK;
+    if(next == key_q_tail) return;      // full: drop the event
+    key_q[h] = k;
+    key_q_head = next;
 }
 
-void lcd_data(unsigned char dat)
+void keypad_tick(void)                  // ISR only
 {
-    RS = 1;
-    RW = 0;
-    LCD_DATA = dat;
-    lcd_pulse();
+    unsigned char rows, r, idx, cnt;
+
+    // Rows of the column driven low one scan ago (settled since then)
+    rows = 0;
+    if(R1 == 0) rows |= 0x01;
+    if(R2 == 0) rows |= 0x02;
+    if(R3 == 0) rows |= 0x04;
+    if(R4 == 0) rows |= 0x08;
+
+    idx = key_col << 2;
+#ifdef EEG_FRONTEND
+    // Rows B and C are P3.1/P3.0 = TXD/RXD, owned by the UART here.
+    // Their keys are ignored, and must not be pressed while streaming:
+    // they tie TXD to the scanned column and corrupt the frame on the wire
+    rows &= 0x09;
+#endif
+
+    for(r = 0; r < 4; r++, idx++, rows >>= 1)
+    {
+        cnt = key_cnt[idx];
+        if(rows & 0x01)
+        {
+            if((cnt & ~KEY_DOWN) < KEY_DEBOUNCE) cnt++;
+            if((cnt & ~KEY_DOWN) == KEY_DEBOUNCE && !(cnt & KEY_DOWN))
+            {
+                cnt |= KEY_DOWN;        // press event
+                key_push(key_map[idx]);
+#ifndef EEG_FRONTEND
+                key_repeat_idx = idx;
+                key_repeat_timer = KEY_REPEAT_DELAY;
+#endif
+            }
+        }
+        else if(cnt & ~KEY_DOWN)
+        {
+            cnt--;
+            if((cnt & ~KEY_DOWN) == 0)
+            {
+                cnt = 0;                // released
+                if(key_repeat_idx == idx) key_repeat_idx = KEY_NONE;
+            }
+        }
+        key_cnt[idx] = cnt;
+    }
+
+    // Auto-repeat the most recently pressed key, once per full sweep
+    if(key_col == 3 && key_repeat_idx != KEY_NONE && --key_repeat_timer == 0)
+    {
+        key_push(key_map[key_repeat_idx]);
+        key_repeat_timer = KEY_REPEAT_RATE;
+    }
+
+    // Drive the next column; it is read on the next scan
+    key_col = (key_col + 1) & 3;
+    C1 = (key_col != 0);
+    C2 = (key_col != 1);
+    C3 = (key_col != 2);
+    C4 = (key_col != 3);
 }
 
-void lcd_clear(void)
+// Next key event, or 0 if none is pending (never blocks)
+char keypad_getkey(void)
 {
-    lcd_cmd(0x01);
-    delay_ms(2);
+    unsigned char t;
+    char k;
+    t = key_q_tail;
+    if(t == key_q_head) return 0;
+    k = key_q[t];
+    key_q_tail = (t + 1) & KEY_Q_MASK;
+    return k;
+}
+
+#ifdef EEG_FRONTEND
+// ================= SAMPLING (EEG_FRONTEND)
+// adc_tick (from the timer-0 ISR) runs every smp_period ticks, so sample
+// instants are locked to the hardware timer; jitter is only interrupt
+// latency. Each run reads the conversion started one period earlier and
+// starts the next one. Samples fill one half of a double buffer while
+// main sends the other half as a frame.
+#define FRAME_SAMPLES  8        // per frame; host FrameFormat(1, 8)
+#define SMP_NONE       0xFF
+
+// ~200 us ticks per sample: 100, 200, 250, 500 Hz
+unsigned char code smp_periods[4] = { 50, 25, 20, 10 };
+unsigned int  code smp_rates[4]   = { 100, 200, 250, 500 };
+// MAX197 control byte: internal clock, bipolar, channel 0; RNG=1 +/-10 V
+// (gain x1), RNG=0 +/-5 V (gain x2)
+unsigned char code adc_ctrl_tab[2] = { 0x58, 0x48 };
+
+int idata smp_buf[2][FRAME_SAMPLES];
+unsigned int idata smp_seq[2];          // frame sequence number per half
+unsigned char smp_fill = 0;             // half the ISR is filling
+unsigned char smp_idx = 0;
+volatile unsigned char smp_ready = SMP_NONE;    // half waiting for main
+unsigned int frame_seq = 0;
+volatile unsigned int smp_count = 0;    // samples taken (wraps)
+volatile unsigned int smp_overruns = 0; // frames dropped: main was too slow
+
+#ifdef EEG_EDGE
+#include "edge_model.h"
+#define SMP_PERIOD_INIT EDGE_PERIOD_TICKS       // the rate the model expects
+#else
+#define SMP_PERIOD_INIT 50
+#endif
+
+volatile unsigned char smp_period = SMP_PERIOD_INIT;
+volatile unsigned char adc_ctrl = 0x58;
+unsigned char smp_div = 0;
+bit adc_started = 0;
+
+void adc_tick(void)                     // ISR only
+{
+    unsigned char lo, hi;
+
+    if(++smp_div < smp_period) return;
+    smp_div = 0;
+
+    if(adc_started)
+    {
+        // Result: low byte, then high nibble (sign-extended when bipolar)
+        ADC_BUS = 0xFF;
+        ADC_CS = 0;
+        ADC_HBEN = 0;
+        ADC_RD = 0;
+        lo = ADC_BUS;
+        ADC_RD = 1;
+        ADC_HBEN = 1;
+        ADC_RD = 0;
+        hi = ADC_BUS;
+        ADC_RD = 1;
+        ADC_CS = 1;
+
+        // 12-bit two's complement scaled to the int16 full range
+        smp_buf[smp_fill][smp_idx] = (int)(((unsigned int)hi << 8) | lo) << 4;
+        smp_count++;
+        if(++smp_idx == FRAME_SAMPLES)
+        {
+            smp_idx = 0;
+            if(smp_ready != SMP_NONE)
+            {
+                // Other half not sent yet: drop this one (its sequence
+                // number is skipped, so the host sees the gap too)
+                smp_overruns++;
+            }
+            else
+            {
+                smp_seq[smp_fill] = frame_seq;
+                smp_ready = smp_fill;
+                smp_fill ^= 1;
+            }
+            frame_seq++;
+        }
+    }
+
+    // Writing the control byte starts acquisition + conversion
+    ADC_CS = 0;
+    ADC_BUS = adc_ctrl;
+    ADC_WR = 0;
+    ADC_WR = 1;
+    ADC_CS = 1;
+    ADC_BUS = 0xFF;
+    adc_started = 1;
+}
+#endif
+
+// ================= TIMER 0 ===============
+void timer0_isr(void) interrupt 1
+{
+#ifdef EEG_FRONTEND
+    adc_tick();                 // first, so sample instants stay fixed
+    tick_div++;
+#else
+    unsigned int t;
+
+    // Length of the period that just started: fast while bytes wait for
+    // the LCD. TH0:TL0 has counted up from 0 since the overflow, so
+    // subtracting the period keeps ISR latency from adding up
+    tick_div += tick_step;
+    tick_step = (lcd_q_tail != lcd_q_head) ? 1 : TICKS_PER_MS;
+    TR0 = 0;
+    t = (((unsigned int)TH0 << 8) | TL0) - (tick_step == 1 ? T0_FAST : T0_SLOW);
+    TH0 = t >> 8;
+    TL0 = t;
+    TR0 = 1;
+#endif
+    if(tick_div >= TICKS_PER_MS)
+    {
+        tick_div -= TICKS_PER_MS;
+        tick_ms++;
+        keypad_tick();
+    }
+    lcd_tick();
+}
+
+void timer0_init(void)
+{
+    unsigned char i;
+    for(i = 0; i < 16; i++) key_cnt[i] = 0;
+
+#ifdef EEG_FRONTEND
+    TMOD = (TMOD & 0xF0) | 0x02;
+    TH0 = T0_RELOAD;
+    TL0 = T0_RELOAD;
+#else
+    TMOD = (TMOD & 0xF0) | 0x01;
+    TH0 = (unsigned char)((65536UL - T0_SLOW) >> 8);
+    TL0 = (unsigned char)(65536UL - T0_SLOW);
+#endif
+    ET0 = 1;
+    TR0 = 1;
+    EA = 1;
+}
+
+// ================= LCD FUNCTIONS =========
+void lcd_cmd(unsigned char cmd)
+{
+    unsigned char h;
+    while(LCD_Q_FREE() < 2) cpu_idle();     // only if the queue is full
+    h = lcd_q_head;
+    lcd_q[h] = LCD_Q_CMD;
+    lcd_q[(h + 1) & LCD_Q_MASK] = cmd;
+    lcd_q_head = (h + 2) & LCD_Q_MASK;  // publish both bytes at once
+}
+
+void lcd_data(unsigned char dat)
+{
+    while(LCD_Q_FREE() == 0) cpu_idle();
+    lcd_q[lcd_q_head] = dat;
+    lcd_q_head = (lcd_q_head + 1) & LCD_Q_MASK;
 }
 
 void lcd_goto(unsigned char row, unsigned char col)
@@ -71,116 +421,240 @@ void lcd_goto(unsigned char row, unsigned char col)
     lcd_cmd(addr);
 }
 
-void lcd_print(char *str)
+// ================= SHADOW DISPLAY ========
+// Screen contents are drawn into a 2x16 RAM framebuffer; a cell whose
+// character changes is marked dirty, and fb_flush sends lcd_goto +
+// lcd_data only for dirty cells that really differ from what the LCD
+// shows (lcd_shown), so clearing and redrawing the same text sends
+// nothing. Redrawing "Result:" over "Enter:" costs a few byte writes
+// instead of a clear plus a full redraw.
+#define FB_COLS   16
+#define FB_CELLS  32
+
+unsigned char idata fb[FB_CELLS];
+unsigned char idata lcd_shown[FB_CELLS];        // what the LCD displays
+unsigned char idata fb_dirty[FB_CELLS / 8];     // one bit per cell
+unsigned char fb_pos = 0;                       // write cursor (cell index)
+unsigned char fb_row_end = FB_COLS;             // cursor stops at row end
+unsigned char lcd_pos = 0;                      // LCD address counter, as a cell
+#define LCD_POS_UNKNOWN 0xFF
+
+unsigned char code bit_mask[8] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
+
+void fb_set(unsigned char i, unsigned char c)
+{
+    if(fb[i] != c)
+    {
+        fb[i] = c;
+        fb_dirty[i >> 3] |= bit_mask[i & 7];
+    }
+}
+
+// Call once after lcd_init: the cleared LCD shows all spaces
+void fb_init(void)
 {
-    while(*str) lcd_data(*str++);
+    unsigned char i;
+    for(i = 0; i < FB_CELLS; i++) fb[i] = lcd_shown[i] = ' ';
+    for(i = 0; i < FB_CELLS / 8; i++) fb_dirty[i] = 0;
+    lcd_pos = 0;
 }
 
-void lcd_print_num(long n)
+void fb_goto(unsigned char row, unsigned char col)
 {
-    char buf[12];
-    char i = 0;
+    fb_pos = row * FB_COLS + col;
+    fb_row_end = (row + 1) * FB_COLS;
+}
+
+void fb_putc(unsigned char c)
+{
+    if(fb_pos >= fb_row_end) return;    // off the visible row
+    fb_set(fb_pos, c);
+    fb_pos++;
+}
 
-    if(n == 0)
+void fb_print(char *str)
+{
+    while(*str) fb_putc(*str++);
+}
+
+#ifndef EEG_FRONTEND
+// Blank the screen (only cells that were not blank become dirty)
+void fb_clear(void)
+{
+    unsigned char i;
+    for(i = 0; i < FB_CELLS; i++) fb_set(i, ' ');
+    fb_goto(0, 0);
+}
+#endif
+
+void fb_flush(void)
+{
+    unsigned char i, m;
+
+    for(i = 0; i < FB_CELLS; i++)
     {
-        lcd_data('0');
-        return;
+        if(fb_dirty[i >> 3] == 0)
+        {
+            i |= 7;                     // skip 8 clean cells at once
+            continue;
+        }
+        m = bit_mask[i & 7];
+        if(!(fb_dirty[i >> 3] & m)) continue;
+        fb_dirty[i >> 3] &= ~m;
+        if(fb[i] == lcd_shown[i]) continue;     // changed back since last flush
+        lcd_shown[i] = fb[i];
+
+        if(lcd_pos != i) lcd_goto(i >> 4, i & (FB_COLS - 1));
+        lcd_data(fb[i]);
+        // Auto-increment runs past col 15 into off-screen DDRAM, not row 1
+        lcd_pos = ((i & (FB_COLS - 1)) == FB_COLS - 1) ? LCD_POS_UNKNOWN : i + 1;
     }
+}
+
+// ================= NUMBER FORMAT =========
+// Table-driven binary -> decimal: each digit is found by repeated
+// subtraction of its power of ten (at most 9 per digit), so printing
+// needs no 32-bit divide / modulo library calls at all.
+unsigned long code pow10_tab[10] = {
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL,
+    10000UL, 1000UL, 100UL, 10UL, 1UL
+};
+
+void fb_print_num(long n)
+{
+    unsigned long u;
+    unsigned long p;
+    unsigned char i, d, started = 0;
 
     if(n < 0)
     {
-        lcd_data('-');
-        n = -n;
+        fb_putc('-');
+        u = (unsigned long)(-(n + 1)) + 1;  // also right for LONG_MIN
+    }
+    else
+    {
+        u = n;
     }
 
-    while(n > 0 && i < 11)
+    for(i = 0; i < 10; i++)
     {
-        buf[i++] = (n % 10) + '0';
-        n /= 10;
+        p = pow10_tab[i];
+        d = 0;
+        while(u >= p)
+        {
+            u -= p;
+            d++;
+        }
+        if(d || started || i == 9)
+        {
+            fb_putc('0' + d);
+            started = 1;
+        }
     }
+}
 
-    while(i--) lcd_data(buf[i]);
+// Power-on init: the busy flag is not valid until function set, so these
+// first writes are timed and go straight to the bus. The ISR leaves the
+// LCD pins alone while its queue is empty, which it is until lcd_init
+// returns.
+void lcd_init_write(unsigned char cmd)
+{
+    RS = 0;
+    RW = 0;
+    LCD_DATA = cmd;
+    EN = 1;
+    delay_ms(2);
+    EN = 0;
+    delay_ms(2);
 }
 
 void lcd_init(void)
 {
     delay_ms(20);
-    lcd_cmd(0x38);   // 8-bit, 2 line
-    lcd_cmd(0x0C);   // display ON, cursor OFF
-    lcd_cmd(0x06);   // entry mode
-    lcd_clear();
+    lcd_init_write(0x38);   // 8-bit, 2 line
+    lcd_init_write(0x0C);   // display ON, cursor OFF
+    lcd_init_write(0x06);   // entry mode
+    lcd_init_write(0x01);   // clear
 }
 
-// ================= KEYPAD SCAN ===========
-char keypad_scan(void)
-{
-    // release columns high
-    C1 = C2 = C3 = C4 = 1;
-
-    // Column 1 low
-    C1=0; C2=1; C3=1; C4=1;
-    if(R1==0) return '7';
-    if(R2==0) return '4';
-    if(R3==0) return '1';
-    if(R4==0) return 'C';
-
-    // Column 2 low
-    C1=1; C2=0; C3=1; C4=1;
-    if(R1==0) return '8';
-    if(R2==0) return '5';
-    if(R3==0) return '2';
-    if(R4==0) return '0';
+#ifndef EEG_FRONTEND
+// ================= CALC LOGIC ============
+// error_flag values set by calc_apply
+#define ERR_NONE      0
+#define ERR_DIV0      1
+#define ERR_OVERFLOW  2
 
-    // Column 3 low
-    C1=1; C2=1; C3=0; C4=1;
-    if(R1==0) return '9';
-    if(R2==0) return '6';
-    if(R3==0) return '3';
-    if(R4==0) return '=';
+#define LONG_MAX_DIV10  214748364L      // 2147483647 / 10
+#define LONG_MIN_VALUE  (-2147483647L - 1)
 
-    // Column 4 low
-    C1=1; C2=1; C3=1; C4=0;
-    if(R1==0) return '/';
-    if(R2==0) return '*';
-    if(R3==0) return '-';
-    if(R4==0) return '+';
+// True if num * 10 + d still fits in a long
+unsigned char digit_fits(long num, unsigned char d)
+{
+    if(num < 0) return num >= -LONG_MAX_DIV10;     // d only moves it toward 0
+    return num < LONG_MAX_DIV10 || (num == LONG_MAX_DIV10 && d <= 7);
+}
 
-    return 0;
+// num * 10 + d as shifts and adds (no long multiply); check digit_fits first
+long append_digit(long num, unsigned char d)
+{
+    return (num << 3) + (num << 1) + d;
 }
 
-char keypad_getkey(void)
+// |a * b| overflow test without dividing: fine when the operands' bit
+// lengths sum to at most 31, overflow when they exceed 32, otherwise
+// decided from the exact unsigned product. (A product of exactly
+// LONG_MIN with 33 operand bits is conservatively reported as overflow.)
+unsigned char mul_overflows(long a, long b)
 {
-    char k;
-    while(1)
-    {
-        k = keypad_scan();
-        if(k != 0)
-        {
-            delay_ms(25);                // debounce
-            if(keypad_scan() == k)
-            {
-                while(keypad_scan() != 0); // wait release
-                return k;
-            }
-        }
-    }
+    unsigned long ua, ub, t;
+    unsigned char bits = 0;
+
+    ua = (a < 0) ? (unsigned long)(-(a + 1)) + 1 : (unsigned long)a;
+    ub = (b < 0) ? (unsigned long)(-(b + 1)) + 1 : (unsigned long)b;
+    if(ua == 0 || ub == 0) return 0;
+
+    for(t = ua; t; t >>= 1) bits++;
+    for(t = ub; t; t >>= 1) bits++;
+    if(bits <= 31) return 0;
+    if(bits > 32) return 1;
+    // bits == 32: product is below 2^32, so the unsigned multiply is exact
+    t = ua * ub;
+    return t > (((a < 0) != (b < 0)) ? 0x80000000UL : 0x7FFFFFFFUL);
 }
 
-// ================= CALC LOGIC ============
 // No pointer arguments -> fixes *err and &err issues in Keil C51
 long calc_apply(long a, long b, char op)
 {
-    error_flag = 0;
+    long r;
+    error_flag = ERR_NONE;
 
     switch(op)
     {
-        case '+': return a + b;
-        case '-': return a - b;
-        case '*': return a * b;
+        case '+':
+            r = a + b;
+            // Same-sign operands with a different-sign result wrapped
+            if((a < 0) == (b < 0) && (r < 0) != (a < 0)) error_flag = ERR_OVERFLOW;
+            return r;
+        case '-':
+            r = a - b;
+            if((a < 0) != (b < 0) && (r < 0) != (a < 0)) error_flag = ERR_OVERFLOW;
+            return r;
+        case '*':
+            if(mul_overflows(a, b))
+            {
+                error_flag = ERR_OVERFLOW;
+                return 0;
+            }
+            return a * b;
         case '/':
             if(b == 0)
             {
-                error_flag = 1;
+                error_flag = ERR_DIV0;
+                return 0;
+            }
+            if(a == LONG_MIN_VALUE && b == -1)
+            {
+                error_flag = ERR_OVERFLOW;  // +2147483648 does not fit
                 return 0;
             }
             return a / b; // integer division
@@ -189,57 +663,128 @@ long calc_apply(long a, long b, char op)
     }
 }
 
+// ================= EXPRESSION ENGINE =====
+// Two-stack (shunting-yard) evaluator folded as keys arrive: when an
+// operator comes in, every pending operator of equal or higher
+// precedence is applied first. With two left-associative precedence
+// levels at most one '+'/'-' can wait under one '*'/'/', so the stacks
+// never hold more than 3 values and 2 operators, and '=' has at most
+// two folds left to do. That holds only until an error: expr_fold stops
+// popping once error_flag is set, so main takes no more operands until
+// '=' or 'C'. The pushes also refuse to write past EXPR_DEPTH.
+#define EXPR_DEPTH 4
+
+long idata expr_val[EXPR_DEPTH];
+char idata expr_op[EXPR_DEPTH];
+unsigned char expr_nv = 0;      // values on the stack
+unsigned char expr_no = 0;      // operators on the stack
+
+unsigned char op_prec(char op)
+{
+    return (op == '*' || op == '/') ? 2 : 1;
+}
+
+void expr_reset(void)
+{
+    expr_nv = 0;
+    expr_no = 0;
+    error_flag = ERR_NONE;
+}
+
+// Apply the top operator to the top two values; sticky on error
+void expr_fold(void)
+{
+    long b;
+    if(error_flag) return;
+    b = expr_val[--expr_nv];
+    expr_nv--;
+    expr_val[expr_nv] = calc_apply(expr_val[expr_nv], b, expr_op[--expr_no]);
+    expr_nv++;
+}
+
+void expr_push_value(long v)
+{
+    if(expr_nv < EXPR_DEPTH) expr_val[expr_nv++] = v;
+}
+
+void expr_push_op(char op)
+{
+    while(expr_no && !error_flag && op_prec(expr_op[expr_no - 1]) >= op_prec(op))
+        expr_fold();
+    if(expr_no < EXPR_DEPTH) expr_op[expr_no++] = op;
+}
+
+// Fold everything left; result is valid when error_flag is ERR_NONE
+long expr_finish(void)
+{
+    while(expr_no && !error_flag) expr_fold();
+    return error_flag ? 0 : expr_val[0];
+}
+
 // ================= MAIN ==================
 void main(void)
 {
-    long num1 = 0, num2 = 0, res = 0;
-    char op = 0;
-    unsigned char have_op = 0;
+    long num = 0, res = 0;          // operand being typed, last result
+    unsigned char have_num = 0;     // digits typed (or a result) for num
     char key;
+    unsigned char d;
 
     // good practice: release ports high
     P0 = 0xFF;  // LCD data (needs external pull-ups; you have resistor network)
     P3 = 0xFF;  // keypad lines high
 
+    timer0_init();          // timebase, LCD output and keypad are interrupt-driven
     lcd_init();
+    fb_init();
 
-    lcd_goto(0,0);
-    lcd_print("AT89S52 Calc");
+    fb_goto(0,0);
+    fb_print("AT89S52 Calc");
+    fb_flush();
     delay_ms(800);
-    lcd_clear();
 
-    lcd_goto(0,0);
-    lcd_print("Enter:");
-    lcd_goto(1,0);
+    fb_clear();
+    fb_print("Enter:");
+    fb_goto(1,0);
 
     while(1)
     {
+        // Push whatever the last key changed on screen, then take the next key
+        fb_flush();
         key = keypad_getkey();
+        if(key == 0)
+        {
+            cpu_idle();     // sleep until the next tick / key event
+            continue;
+        }
 
         // CLEAR
         if(key == 'C')
         {
-            num1 = 0; num2 = 0; res = 0;
-            op = 0; have_op = 0;
-            error_flag = 0;
-
-            lcd_clear();
-            lcd_goto(0,0);
-            lcd_print("Enter:");
-            lcd_goto(1,0);
+            num = 0; res = 0;
+            have_num = 0;
+            expr_reset();
+
+            fb_clear();
+            fb_print("Enter:");
+            fb_goto(1,0);
             continue;
         }
 
-        // OPERATOR
+        // OPERATOR: folds pending higher/equal-precedence operators now
         if(key=='+' || key=='-' || key=='*' || key=='/')
         {
-            if(!have_op)
+            // A second operator in a row is ignored, and so is every
+            // operator after an error until '=' shows it or 'C'
+            if(!error_flag && (have_num || expr_no == 0))
             {
-                op = key;
-                have_op = 1;
-                lcd_data(' ');
-                lcd_data(op);
-                lcd_data(' ');
+                expr_push_value(num);
+                expr_push_op(key);
+                num = 0;
+                have_num = 0;
+
+                fb_putc(' ');
+                fb_putc(key);
+                fb_putc(' ');
             }
             continue;
         }
@@ -247,25 +792,26 @@ void main(void)
         // EQUAL
         if(key == '=')
         {
-            if(have_op)
+            if(expr_no)
             {
-                res = calc_apply(num1, num2, op);
+                expr_push_value(num);
+                res = expr_finish();
 
-                lcd_clear();
-                lcd_goto(0,0);
-                lcd_print("Result:");
-                lcd_goto(1,0);
+                fb_clear();
+                fb_print("Result:");
+                fb_goto(1,0);
 
-                if(error_flag)
-                    lcd_print("Error: /0");
+                if(error_flag == ERR_DIV0)
+                    fb_print("Error: /0");
+                else if(error_flag == ERR_OVERFLOW)
+                    fb_print("Error: ovf");
                 else
-                    lcd_print_num(res);
+                    fb_print_num(res);
 
                 // next expression starts from result
-                num1 = error_flag ? 0 : res;
-                num2 = 0;
-                have_op = 0;
-                op = 0;
+                num = error_flag ? 0 : res;
+                have_num = !error_flag;
+                expr_reset();
             }
             continue;
         }
@@ -273,12 +819,345 @@ void main(void)
         // DIGIT
         if(key >= '0' && key <= '9')
         {
-            lcd_data(key);
+            d = key - '0';
 
-            if(!have_op)
-                num1 = (num1 * 10) + (key - '0');
-            else
-                num2 = (num2 * 10) + (key - '0');
+            // A digit that would overflow the operand is refused, as are
+            // digits after an error
+            if(error_flag || !digit_fits(num, d))
+                continue;
+            fb_putc(key);
+
+            num = append_digit(num, d);
+            have_num = 1;
+        }
+    }
+}
+
+#else /* EEG_FRONTEND */
+// ================= UART (EEG_FRONTEND) ===
+// Timer 2 as baud generator: 11059200 / (32 * 3) = 115200 baud
+#ifndef EEG_EDGE
+#define FRAME_SYNC0  0xA5
+#define FRAME_SYNC1  0x5A
+
+// CRC-16/CCITT-FALSE, one nibble at a time (16-entry table in code space)
+unsigned int code crc_nibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+unsigned int frame_crc;
+#endif
+
+void uart_init(void)
+{
+    SCON = 0x50;                // mode 1, 8-bit UART, receiver enabled
+    RCAP2H = 0xFF;
+    RCAP2L = 0xFD;
+    TH2 = 0xFF;
+    TL2 = 0xFD;
+    T2CON = 0x34;               // RCLK + TCLK from timer 2, TR2 = 1
+    TI = 1;                     // transmitter idle
+}
+
+void uart_put(unsigned char b)
+{
+    while(!TI);
+    TI = 0;
+    SBUF = b;
+}
+
+#ifdef EEG_EDGE
+// ================= EDGE INFERENCE (EEG_EDGE)
+// Features of consecutive EDGE_WINDOW-sample windows, accumulated as
+// frames arrive (only running sums are kept, no window buffer), then
+// classified by the pruned forest in code memory. Features are in 1/8
+// ADC code like eeg_edge.py quantizes the thresholds; gain stays x1.
+#define EDGE_FRAC_BITS 3
+
+#if EDGE_WINDOW > 512
+#error "EDGE_WINDOW too long for the 32-bit sum of squares"
+#endif
+
+// Sums are taken relative to the previous window's mean so they stay
+// small; the variance's mean term is truncated, so std can come out a
+// little high when the mean drifts within a window
+int edge_ref = 0;
+bit edge_ref_set = 0;
+long edge_sum;                  // sum of (code - edge_ref)
+unsigned long edge_sumsq;       // sum of (code - edge_ref)^2, saturating
+int edge_min, edge_max;
+unsigned int edge_n = 0;
+int idata edge_f[5];            // mean, std, min, max, ptp
+unsigned char edge_state = 0xFF;        // last class reported, none yet
+
+unsigned int isqrt(unsigned long v)
+{
+    unsigned long root = 0, b = 1UL << 30;
+
+    while(b > v) b >>= 2;
+    while(b)
+    {
+        if(v >= root + b)
+        {
+            v -= root + b;
+            root = (root >> 1) + b;
         }
+        else root >>= 1;
+        b >>= 2;
+    }
+    return (unsigned int)root;
+}
+
+void edge_window_features(void)
+{
+    long m8, var;
+
+    // 8 x mean of (code - edge_ref): floored for the mean feature,
+    // truncated for the variance so its square is never too big
+    m8 = edge_sum * 8 / EDGE_WINDOW;
+    var = (long)(edge_sumsq / EDGE_WINDOW) * 64
+        + (long)(edge_sumsq % EDGE_WINDOW) * 64 / EDGE_WINDOW
+        - m8 * m8;
+    if(m8 * EDGE_WINDOW > edge_sum * 8) m8--;
+
+    edge_f[0] = edge_ref * 8 + (int)m8;
+    edge_f[1] = var > 0 ? (int)isqrt(var) : 0;
+    edge_f[2] = edge_min << EDGE_FRAC_BITS;
+    edge_f[3] = edge_max << EDGE_FRAC_BITS;
+    edge_f[4] = edge_f[3] - edge_f[2];
+    edge_ref = edge_f[0] >> EDGE_FRAC_BITS;
+}
+
+// Returns 1 when this frame completed a window
+bit edge_push(unsigned char half)
+{
+    unsigned char i;
+    int c, d;
+    unsigned long dd;
+    bit done = 0;
+
+    for(i = 0; i < FRAME_SAMPLES; i++)
+    {
+        c = smp_buf[half][i] >> 4;      // back to the signed 12-bit code
+        if(!edge_ref_set)
+        {
+            edge_ref = c;
+            edge_ref_set = 1;
+        }
+        if(edge_n == 0)
+        {
+            edge_sum = 0;
+            edge_sumsq = 0;
+            edge_min = c;
+            edge_max = c;
+        }
+        else if(c < edge_min) edge_min = c;
+        else if(c > edge_max) edge_max = c;
+
+        d = c - edge_ref;
+        dd = (unsigned long)((long)d * d);
+        edge_sum += d;
+        edge_sumsq = (edge_sumsq > 0xFFFFFFFFUL - dd) ? 0xFFFFFFFFUL : edge_sumsq + dd;
+
+        // Window boundaries need not line up with frames
+        if(++edge_n == EDGE_WINDOW)
+        {
+            edge_n = 0;
+            edge_window_features();
+            done = 1;
+        }
+    }
+    return done;
+}
+
+unsigned char edge_classify(void)
+{
+    unsigned char t, c, best;
+    unsigned char votes[EDGE_CLASSES];
+    edge_node_t n;
+
+    for(c = 0; c < EDGE_CLASSES; c++) votes[c] = 0;
+    for(t = 0; t < EDGE_TREES; t++)
+    {
+        n = edge_roots[t];
+        while(edge_feat[n] != EDGE_LEAF)
+            n = (edge_f[edge_feat[n]] <= edge_thr[n]) ? edge_left[n] : edge_right[n];
+        votes[edge_left[n]]++;          // a leaf's left holds its class
+    }
+
+    // Majority vote, ties to the lower class (as EdgeForest.predict)
+    best = 0;
+    for(c = 1; c < EDGE_CLASSES; c++)
+        if(votes[c] > votes[best]) best = c;
+    return best;
+}
+
+void uart_print(char code *str)
+{
+    while(*str) uart_put(*str++);
+}
+#else
+// Send a byte and fold it into frame_crc while it shifts out
+void uart_put_crc(unsigned char b)
+{
+    uart_put(b);
+    frame_crc = (frame_crc << 4) ^ crc_nibble[(frame_crc >> 12) ^ (b >> 4)];
+    frame_crc = (frame_crc << 4) ^ crc_nibble[(frame_crc >> 12) ^ (b & 0x0F)];
+}
+
+// One eeg_protocol frame: sync, seq, FRAME_SAMPLES int16 LE, CRC LE
+void send_frame(unsigned char half)
+{
+    unsigned char i;
+    int s;
+
+    uart_put(FRAME_SYNC0);
+    uart_put(FRAME_SYNC1);
+    frame_crc = 0xFFFF;
+    uart_put_crc(smp_seq[half] & 0xFF);
+    uart_put_crc(smp_seq[half] >> 8);
+    for(i = 0; i < FRAME_SAMPLES; i++)
+    {
+        s = smp_buf[half][i];
+        uart_put_crc(s & 0xFF);
+        uart_put_crc((unsigned int)s >> 8);
+    }
+    uart_put(frame_crc & 0xFF);
+    uart_put(frame_crc >> 8);
+}
+#endif /* EEG_EDGE */
+
+// ISR-owned 16-bit counters need a stable double read on the 8051
+unsigned int read_isr_word(volatile unsigned int *p)
+{
+    unsigned int v;
+    do { v = *p; } while(v != *p);
+    return v;
+}
+
+void fb_clear_row(unsigned char row)
+{
+    unsigned char i;
+    fb_goto(row, 0);
+    for(i = 0; i < FB_COLS; i++) fb_putc(' ');
+    fb_goto(row, 0);
+}
+
+// ================= MAIN (EEG_FRONTEND) ===
+// Keys (rows A and D only, one step per press, see keypad_tick):
+//   '+'  next sample rate     '/'  toggle gain x1 / x2
+//   'C'  reset overrun count
+// The host must be told the same setting (eeg_gui.DEVICE_PROFILE =
+// eeg_protocol.frontend_profile(rate, gain)) to scale and time samples.
+// EEG_EDGE fixes rate and gain to what the model was exported for, so
+// only 'C' is live; each window's class is shown and, when it changes,
+// sent to the host as a "State: <name>" line instead of sample frames.
+void main(void)
+{
+    unsigned char rate = 0, gain = 0;
+    unsigned int last_count, count, last_ms, now;
+    unsigned int measured = 0;
+    unsigned char half;
+    char key;
+    bit redraw;
+
+    P0 = 0xFF;
+    P1 = 0xFF;                  // ADC bus released
+    P3 = 0xFF;
+    ADC_CS = 1;
+    ADC_WR = 1;
+    ADC_RD = 1;
+
+    uart_init();
+    timer0_init();
+    lcd_init();
+    fb_init();
+
+    last_count = read_isr_word(&smp_count);
+    last_ms = millis();
+
+    while(1)
+    {
+        // Ship a finished half-buffer as soon as the ISR hands it over
+        redraw = 0;
+        half = smp_ready;
+        if(half != SMP_NONE)
+        {
+#ifdef EEG_EDGE
+            redraw = edge_push(half);
+            smp_ready = SMP_NONE;       // classify outside the handover
+            if(redraw)
+            {
+                half = edge_classify();
+                if(half != edge_state)
+                {
+                    edge_state = half;
+                    uart_print("State: ");
+                    uart_print(edge_names[half]);
+                    uart_print("\r\n");
+                }
+            }
+#else
+            send_frame(half);
+            smp_ready = SMP_NONE;
+#endif
+        }
+
+        key = keypad_getkey();
+        if(key) redraw = 1;
+#ifndef EEG_EDGE
+        if(key == '+')
+        {
+            rate = (rate + 1) & 3;
+            smp_period = smp_periods[rate];
+        }
+        else if(key == '/')
+        {
+            gain ^= 1;
+            adc_ctrl = adc_ctrl_tab[gain];
+        }
+        else
+#endif
+        if(key == 'C')
+        {
+            EA = 0;
+            smp_overruns = 0;
+            EA = 1;
+        }
+
+        // Live status once a second: set rate/gain, measured rate, overruns
+        now = millis();
+        if(redraw || (unsigned int)(now - last_ms) >= 1000)
+        {
+            if((unsigned int)(now - last_ms) >= 1000)
+            {
+                count = read_isr_word(&smp_count);
+                measured = (unsigned int)((unsigned long)(count - last_count) * 1000UL
+                                          / (unsigned int)(now - last_ms));
+                last_count = count;
+                last_ms = now;
+            }
+#ifdef EEG_EDGE
+            fb_clear_row(0);
+            fb_print("State:");
+            fb_print(edge_state == 0xFF ? "..." : (char *)edge_names[edge_state]);
+#else
+            fb_clear_row(0);
+            fb_print_num(smp_rates[rate]);
+            fb_print("Hz x");
+            fb_putc(gain ? '2' : '1');
+            fb_print(gain ? " 5V" : " 10V");
+#endif
+            fb_clear_row(1);
+            fb_print("Fs:");
+            fb_print_num(measured);
+            fb_print(" Ovr:");
+            fb_print_num(read_isr_word(&smp_overruns));
+        }
+        fb_flush();
+
+        if(smp_ready == SMP_NONE && key == 0) cpu_idle();
     }
 }
+#endif /* EEG_FRONTEND */
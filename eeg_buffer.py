@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""
+Preallocated sample ring buffer shared between the serial reader thread
+and the plotting / classification code.
+
+Threading contract (single producer, single consumer):
+    - Exactly one thread calls `append` / `extend` (the SerialReader).
+    - Any number of readers may call `views` / `copy_latest`, but they must
+      not write to the buffer.
+    - The producer fills the slots first and only then publishes them by
+      advancing the write counter, which is a single attribute store and
+      therefore atomic under the GIL. A reader takes one snapshot of the
+      counter and only looks at slots before it, so no lock is needed.
+    - The ring overwrites the oldest samples, like a deque with maxlen.
+      Size it with headroom over the largest window a reader asks for so
+      the producer cannot lap a reader during one frame; `intact` tells a
+      reader after the fact whether that happened.
+"""
+
+from __future__ import annotations
+
+from typing import Any, Iterable, Optional, Tuple
+
+import numpy as np
+
+
+class RingBuffer:
+    """
+    Fixed-capacity, contiguous ring of samples with zero-copy readout.
+
+    `views(n)` returns the last n samples, oldest first, as at most two
+    NumPy views into the underlying storage (two only when the requested
+    range wraps around the end of the ring).
+
+    With `channels` set the storage is structure-of-arrays, shape
+    (channels, capacity): every channel's history is contiguous, one
+    sample is a vector of `channels` values, and views have shape
+    (channels, n).
+    """
+
+    def __init__(
+        self,
+        capacity: int,
+        dtype: Any = np.float64,
+        channels: Optional[int] = None,
+    ) -> None:
+        if capacity <= 0:
+            raise ValueError("capacity must be positive")
+        self.capacity = int(capacity)
+        self.channels = channels
+        shape = (self.capacity,) if channels is None else (int(channels), self.capacity)
+        self._data = np.zeros(shape, dtype=dtype)
+        self._written = 0  # total samples ever published (producer-owned)
+
+    # ---------------- producer side ----------------
+    def append(self, value: Any) -> None:
+        """Publish one sample (a vector of `channels` values if set)."""
+        written = self._written
+        self._data[..., written % self.capacity] = value
+        self._written = written + 1
+
+    def extend(self, values: Iterable[Any]) -> None:
+        """
+        Publish a block of samples with at most two slice copies.
+
+        Multi-channel blocks have shape (n, channels), as they come from
+        the frame decoder.
+        """
+        block = np.asarray(values, dtype=self._data.dtype)
+        if self.channels is None:
+            block = block.ravel()
+        else:
+            block = block.reshape(-1, self.channels).T
+        n = block.shape[-1]
+        if n == 0:
+            return
+
+        written = self._written
+        if n > self.capacity:
+            # Only the newest `capacity` samples can survive anyway
+            written += n - self.capacity
+            block = block[..., -self.capacity :]
+            n = self.capacity
+
+        start = written % self.capacity
+        first = min(n, self.capacity - start)
+        self._data[..., start : start + first] = block[..., :first]
+        if first < n:
+            self._data[..., : n - first] = block[..., first:]
+        self._written = written + n
+
+    def clear(self) -> None:
+        """Drop all samples. Only safe while the producer is stopped."""
+        self._written = 0
+
+    # ---------------- consumer side ----------------
+    @property
+    def written(self) -> int:
+        """Monotonic count of samples published since creation/clear."""
+        return self._written
+
+    def __len__(self) -> int:
+        return min(self._written, self.capacity)
+
+    def __bool__(self) -> bool:
+        return self._written > 0
+
+    def views(
+        self,
+        n: Optional[int] = None,
+        written: Optional[int] = None,
+    ) -> Tuple[np.ndarray, np.ndarray]:
+        """
+        Zero-copy views of the last `n` samples (all stored if None).
+
+        Returns (older, newer); `newer` is empty unless the range wraps.
+        Pass `written` to read relative to an earlier snapshot of the
+        write counter instead of the current one.
+        """
+        end = self._written if written is None else written
+        count = min(end, self.capacity)
+        if n is not None:
+            count = min(count, max(int(n), 0))
+
+        start = (end - count) % self.capacity
+        stop = start + count
+        if stop <= self.capacity:
+            return self._data[..., start:stop], self._data[..., :0]
+        return self._data[..., start:], self._data[..., : stop - self.capacity]
+
+    def copy_latest(self, out: np.ndarray, written: Optional[int] = None) -> int:
+        """
+        Copy the newest samples into the tail of a preallocated `out`
+        (shape (n,), or (channels, n) for a multi-channel ring).
+
+        Returns the number of samples copied (less than n until the ring
+        has filled up). Nothing is allocated apart from the views.
+        """
+        size = out.shape[-1]
+        older, newer = self.views(size, written)
+        n_old = older.shape[-1]
+        n = n_old + newer.shape[-1]
+        dst = size - n
+        out[..., dst : dst + n_old] = older
+        out[..., dst + n_old :] = newer
+        return n
+
+    def intact(self, written: int, n: int) -> bool:
+        """
+        True if the last `n` samples before the `written` snapshot have not
+        been overwritten by the producer since the snapshot was taken.
+        """
+        return self._written - written <= self.capacity - n
+
+
+__all__ = ["RingBuffer"]
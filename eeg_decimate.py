@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""
+Min/max decimation for plotting more samples than there are pixels.
+
+Drawing a line through N samples on a W-pixel-wide axis costs O(N) in
+the renderer even though at most W columns can change. Keeping only the
+minimum and maximum of each pixel-wide bin draws the same envelope,
+spikes included, with 2*W points.
+
+`minmax_decimate` does this on the fly for short windows (the live
+plot); `MinMaxPyramid` precomputes it at several resolutions so that
+views of long recordings stay O(W) at any zoom level.
+"""
+
+from __future__ import annotations
+
+import math
+from functools import lru_cache
+from typing import List, Optional, Tuple
+
+import numpy as np
+
+
+@lru_cache(maxsize=16)
+def _bin_edges(n: int, n_bins: int) -> np.ndarray:
+    edges = (np.arange(n_bins, dtype=np.int64) * n) // n_bins
+    edges.setflags(write=False)
+    return edges
+
+
+def minmax_decimate(
+    y: np.ndarray,
+    n_bins: int,
+    out: Optional[np.ndarray] = None,
+) -> np.ndarray:
+    """
+    Reduce `y` to alternating (min, max) pairs over `n_bins` equal bins.
+
+    Returns an array of length 2 * n_bins (written into `out` if given).
+    If y is not longer than that, it is returned unchanged.
+    """
+    y = np.asarray(y)
+    if y.size <= 2 * n_bins:
+        return y
+    edges = _bin_edges(y.size, n_bins)
+    if out is None:
+        out = np.empty(2 * n_bins, dtype=y.dtype)
+    out[0::2] = np.minimum.reduceat(y, edges)
+    out[1::2] = np.maximum.reduceat(y, edges)
+    return out
+
+
+def decimated_x(n: int, n_bins: int, x0: float = 0.0, dx: float = 1.0) -> np.ndarray:
+    """X positions matching `minmax_decimate(y, n_bins)` for len(y) == n."""
+    if n <= 2 * n_bins:
+        return x0 + dx * np.arange(n, dtype=float)
+    edges = _bin_edges(n, n_bins).astype(float)
+    return x0 + dx * np.repeat(edges, 2)
+
+
+def minmax_decimate_xy(
+    y: np.ndarray,
+    n_bins: int,
+    x0: float = 0.0,
+    dx: float = 1.0,
+) -> Tuple[np.ndarray, np.ndarray]:
+    """(x, y) pair for plotting a decimated, uniformly sampled signal."""
+    return decimated_x(np.asarray(y).size, n_bins, x0, dx), minmax_decimate(y, n_bins)
+
+
+class MinMaxPyramid:
+    """
+    Multi-resolution min/max index over one recording.
+
+    Level k stores the min and max of consecutive bins of factor**k
+    samples (level 0 is the signal itself, which may be a memmap). Built
+    in one vectorized pass per level, about 2/(factor-1) of the signal's
+    size in total.
+    """
+
+    def __init__(self, y: np.ndarray, factor: int = 4, min_bins: int = 1024) -> None:
+        if factor < 2:
+            raise ValueError("factor must be at least 2")
+        self.y = y
+        self.factor = int(factor)
+        # (samples per bin, mins, maxs), finest first
+        self.levels: List[Tuple[int, np.ndarray, np.ndarray]] = []
+
+        mins = maxs = np.asarray(y)
+        bin_size = 1
+        while mins.size > min_bins:
+            edges = np.arange(0, mins.size, self.factor)
+            mins = np.minimum.reduceat(mins, edges)
+            maxs = np.maximum.reduceat(maxs, edges)
+            bin_size *= self.factor
+            self.levels.append((bin_size, mins, maxs))
+
+    def __len__(self) -> int:
+        return int(np.asarray(self.y).shape[0])
+
+    def query(self, x0: float, x1: float, n_pixels: int) -> Tuple[np.ndarray, np.ndarray]:
+        """
+        (x, y) to draw samples [x0, x1] on an axis n_pixels wide.
+
+        Picks the coarsest level that still has at least one bin per
+        pixel, so the result has between n_pixels and about
+        2 * factor * n_pixels points however long the recording is.
+        """
+        n = len(self)
+        start = max(int(math.floor(x0)), 0)
+        stop = min(int(math.ceil(x1)) + 1, n)
+        if stop <= start:
+            return np.zeros(0), np.zeros(0)
+
+        per_pixel = (stop - start) / max(n_pixels, 1)
+        level = None
+        for entry in self.levels:
+            if entry[0] <= per_pixel:
+                level = entry
+            else:
+                break
+
+        if level is None:
+            return np.arange(start, stop, dtype=float), np.asarray(self.y[start:stop])
+
+        bin_size, mins, maxs = level
+        i0 = start // bin_size
+        i1 = min(-(-stop // bin_size), mins.size)
+        y = np.empty(2 * (i1 - i0), dtype=mins.dtype)
+        y[0::2] = mins[i0:i1]
+        y[1::2] = maxs[i0:i1]
+        x = np.repeat(np.arange(i0, i1, dtype=float) * bin_size, 2)
+        return x, y
+
+
+__all__ = ["minmax_decimate", "decimated_x", "minmax_decimate_xy", "MinMaxPyramid"]
@@ -0,0 +1,337 @@
+#!/usr/bin/env python3
+"""
+Export a pruned, quantized forest for on-board inference (EEG_EDGE).
+
+The AT89S52 firmware (calculator.c built with EEG_EDGE) classifies on
+the board itself and only reports state changes to the host. It has
+no room for 200 full-depth trees over band powers, so the export
+shrinks the trained sklearn forest to something that fits in code
+memory:
+
+    - only the time-domain features the firmware computes per sample
+      (mean, std, min, max, peak-to-peak) can be tested; a split on a
+      band power is collapsed into its heavier child
+    - trees are cut at --depth, a cut node becoming a majority leaf
+    - the --trees trees that lost the least training mass to collapsed
+      splits are kept, and vote by majority
+
+Features are fixed-point in 1/8 of an ADC code (FEATURE_FRAC_BITS) so
+peak-to-peak over the 12-bit range still fits an int16, and thresholds
+are quantized to the same scale: x <= t becomes x_q <= floor(t_q).
+
+    python eeg_edge.py models/eeg_state_model.pkl --out edge_model.h
+    python eeg_edge.py models/eeg_state_model.pkl --check data/eeg_a.csv
+
+--check replays a recording through an integer model of the firmware
+feature arithmetic and reports how often the edge model agrees with
+the full forest.
+"""
+
+from __future__ import annotations
+
+import argparse
+import os
+import sys
+from dataclasses import dataclass
+from typing import Any, List, Tuple
+
+import numpy as np
+
+from eeg_features import DEFAULT_FS, extract_features_batch
+
+
+EDGE_HEADER_PATH = "edge_model.h"
+EDGE_FEATURES = ("mean", "std", "min", "max", "ptp")  # extract_features[0:5]
+FEATURE_FRAC_BITS = 3
+ADC_BITS = 12
+VOLTS_PER_CODE = 20.0 / (1 << ADC_BITS)  # MAX197 at +/-10 V (front-end gain x1)
+TICKS_PER_SECOND = 5000  # firmware timer-0 tick, ~200 us
+MAX_WINDOW = 512  # firmware sum of squares must fit 32 bits
+EDGE_LEAF = 0xFF
+
+# Same labels as eeg_gui.CLASS_NAMES (importing it would pull in Qt)
+CLASS_NAMES = {0: "Relaxed", 1: "Focused", 2: "Sleepy"}
+
+
+@dataclass
+class EdgeForest:
+    feature: np.ndarray  # uint8 (n_nodes,), EDGE_LEAF at leaves
+    threshold: np.ndarray  # int16 (n_nodes,), fixed-point
+    left: np.ndarray  # (n_nodes,) child index, class index at leaves
+    right: np.ndarray  # (n_nodes,)
+    roots: np.ndarray  # (n_trees,)
+    classes: np.ndarray  # (n_classes,) labels of the source forest
+    lost: np.ndarray  # float (n_trees,) training mass lost per kept tree
+
+    @property
+    def n_trees(self) -> int:
+        return int(self.roots.size)
+
+    @property
+    def n_nodes(self) -> int:
+        return int(self.feature.size)
+
+    def predict_index(self, Xq: np.ndarray) -> np.ndarray:
+        """Class indices for rows of fixed-point features, as the firmware votes."""
+        Xq = np.atleast_2d(np.asarray(Xq, dtype=np.int64))
+        out = np.empty(Xq.shape[0], dtype=np.int64)
+        for r, x in enumerate(Xq):
+            votes = np.zeros(self.classes.size, dtype=np.int64)
+            for node in self.roots:
+                while self.feature[node] != EDGE_LEAF:
+                    go_left = x[self.feature[node]] <= self.threshold[node]
+                    node = self.left[node] if go_left else self.right[node]
+                votes[self.left[node]] += 1
+            out[r] = int(np.argmax(votes))  # ties go to the lower index, as in C
+        return out
+
+    def predict(self, Xq: np.ndarray) -> np.ndarray:
+        return self.classes[self.predict_index(Xq)]
+
+
+def quantize(volts: np.ndarray, volts_per_code: float = VOLTS_PER_CODE) -> np.ndarray:
+    """Fixed-point value (1/8 code) of a voltage, rounded down, clipped to int16."""
+    q = np.floor(np.asarray(volts, dtype=float) / volts_per_code * (1 << FEATURE_FRAC_BITS))
+    return np.clip(q, -32768, 32767).astype(np.int64)
+
+
+def _prune_tree(est: Any, max_depth: int) -> Tuple[Any, float]:
+    """
+    Pruned copy of one sklearn tree, plus the fraction of its training
+    mass that collapsed splits routed away from its own subtree.
+
+    The copy is nested tuples: (class_index,) at leaves and
+    (feature, threshold_volts, left, right) at splits.
+    """
+    tree = est.tree_
+    weight = tree.weighted_n_node_samples
+    lost = 0.0
+
+    def build(node: int, depth: int) -> Any:
+        nonlocal lost
+        while True:
+            left, right = tree.children_left[node], tree.children_right[node]
+            if left < 0 or depth >= max_depth:
+                return (int(np.argmax(tree.value[node, 0])),)
+            if tree.feature[node] < len(EDGE_FEATURES):
+                break
+            # Band-power split: follow the branch most training samples took
+            heavy, light = (left, right) if weight[left] >= weight[right] else (right, left)
+            lost += weight[light] / weight[0]
+            node = heavy
+
+        lo = build(left, depth + 1)
+        hi = build(right, depth + 1)
+        if len(lo) == 1 and lo == hi:
+            return lo  # both sides vote the same class
+        return (int(tree.feature[node]), float(tree.threshold[node]), lo, hi)
+
+    return build(0, 0), lost
+
+
+def build_edge_forest(
+    clf: Any,
+    n_trees: int = 5,
+    max_depth: int = 5,
+    volts_per_code: float = VOLTS_PER_CODE,
+) -> EdgeForest:
+    """Prune, rank and quantize a fitted sklearn forest (see module docstring)."""
+    estimators = getattr(clf, "estimators_", [clf])
+    pruned = [_prune_tree(est, max_depth) for est in estimators]
+    # Stable sort: among equally faithful trees keep the training order
+    order = sorted(range(len(pruned)), key=lambda i: pruned[i][1])[:n_trees]
+
+    feature: List[int] = []
+    threshold: List[int] = []
+    left: List[int] = []
+    right: List[int] = []
+
+    def emit(node: Any) -> int:
+        idx = len(feature)
+        feature.append(EDGE_LEAF)
+        threshold.append(0)
+        left.append(0)
+        right.append(0)
+        if len(node) == 1:
+            left[idx] = node[0]
+            return idx
+        feat, thr, lo, hi = node
+        feature[idx] = feat
+        threshold[idx] = int(quantize(thr, volts_per_code))
+        left[idx] = emit(lo)
+        right[idx] = emit(hi)
+        return idx
+
+    roots = [emit(pruned[i][0]) for i in order]
+    return EdgeForest(
+        feature=np.array(feature, dtype=np.uint8),
+        threshold=np.array(threshold, dtype=np.int16),
+        left=np.array(left, dtype=np.int32),
+        right=np.array(right, dtype=np.int32),
+        roots=np.array(roots, dtype=np.int32),
+        classes=np.asarray(clf.classes_),
+        lost=np.array([pruned[i][1] for i in order]),
+    )
+
+
+def edge_features(codes: np.ndarray) -> np.ndarray:
+    """
+    Fixed-point features of windows of signed ADC codes, shape (..., n).
+
+    Integer arithmetic as in the firmware's edge_window_features():
+    floor of 8 x mean, min, max, peak-to-peak and std (population). The
+    firmware's std can come out slightly higher when the mean drifts
+    within a window, see calculator.c.
+    """
+    c = np.asarray(codes, dtype=np.int64)
+    n = c.shape[-1]
+    one = 1 << FEATURE_FRAC_BITS
+    total = c.sum(axis=-1)
+    var_q = (one * one) * (n * (c * c).sum(axis=-1) - total * total) // (n * n)
+    out = np.empty(c.shape[:-1] + (len(EDGE_FEATURES),), dtype=np.int64)
+    out[..., 0] = (one * total) // n
+    out[..., 1] = np.floor(np.sqrt(var_q.astype(float))).astype(np.int64)
+    out[..., 2] = one * c.min(axis=-1)
+    out[..., 3] = one * c.max(axis=-1)
+    out[..., 4] = out[..., 3] - out[..., 2]
+    return out
+
+
+def _c_array(ctype: str, name: str, values: np.ndarray, per_line: int = 12) -> str:
+    items = [str(int(v)) for v in values]
+    lines = [
+        "    " + ", ".join(items[i : i + per_line]) + ","
+        for i in range(0, len(items), per_line)
+    ]
+    if lines:
+        lines[-1] = lines[-1][:-1]
+    return f"{ctype} code {name}[{len(items)}] = {{\n" + "\n".join(lines) + "\n};\n"
+
+
+def write_header(
+    forest: EdgeForest,
+    path: str = EDGE_HEADER_PATH,
+    fs: float = DEFAULT_FS,
+    window_seconds: float = 3.0,
+    source: str = "",
+) -> None:
+    """Emit the code-memory tables and build constants for calculator.c."""
+    window = int(round(window_seconds * fs))
+    period = TICKS_PER_SECOND / fs
+    if not 2 <= window <= MAX_WINDOW:
+        raise ValueError(f"window of {window} samples outside 2..{MAX_WINDOW}")
+    if period != int(period) or not 1 <= period <= 255:
+        raise ValueError(f"fs = {fs:g} Hz is not a whole number of 200 us ticks")
+    node_t = "unsigned char" if forest.n_nodes <= 255 else "unsigned int"
+    names = [CLASS_NAMES.get(int(c), str(c))[:10] for c in forest.classes]
+    width = max(len(n) for n in names) + 1
+
+    out = [
+        f"// Generated by eeg_edge.py{' from ' + source if source else ''}; do not edit.",
+        f"// {forest.n_trees} trees, {forest.n_nodes} nodes; features in 1/"
+        f"{1 << FEATURE_FRAC_BITS} ADC code ({VOLTS_PER_CODE * 1e3:.4g} mV/code assumed).",
+        "",
+        f"#define EDGE_WINDOW        {window}       // samples per classified window",
+        f"#define EDGE_PERIOD_TICKS  {int(period)}        // sample period, {fs:g} Hz",
+        f"#define EDGE_TREES         {forest.n_trees}",
+        f"#define EDGE_CLASSES       {forest.classes.size}",
+        f"#define EDGE_LEAF          0x{EDGE_LEAF:02X}     // edge_feat[] value at leaves",
+        "",
+        f"typedef {node_t} edge_node_t;",
+        "",
+        _c_array("unsigned char", "edge_feat", forest.feature),
+        _c_array("int", "edge_thr", forest.threshold),
+        _c_array("edge_node_t", "edge_left", forest.left),
+        _c_array("edge_node_t", "edge_right", forest.right),
+        _c_array("edge_node_t", "edge_roots", forest.roots),
+        f"char code edge_names[EDGE_CLASSES][{width}] = {{",
+        ",\n".join(f'    "{n}"' for n in names),
+        "};",
+        "",
+    ]
+    os.makedirs(os.path.dirname(path) or ".", exist_ok=True)
+    with open(path, "w", encoding="utf-8") as f:
+        f.write("\n".join(out))
+
+
+def check_agreement(
+    clf: Any,
+    forest: EdgeForest,
+    path: str,
+    window_seconds: float,
+    volts_per_code: float = VOLTS_PER_CODE,
+) -> float:
+    """Fraction of a recording's windows where edge and full model agree."""
+    from eeg_recording import open_recording
+
+    rec = open_recording(path)
+    volts = np.asarray(rec.voltage, dtype=float)
+    if volts.ndim == 2:
+        volts = volts[:, 0]
+    n = int(round(window_seconds * rec.fs))
+    rows = volts.size // n
+    if rows == 0:
+        raise ValueError(f"{path} is shorter than one window")
+    windows = volts[: rows * n].reshape(rows, n)
+    codes = np.clip(np.floor(windows / volts_per_code), -(1 << (ADC_BITS - 1)), (1 << (ADC_BITS - 1)) - 1)
+    full = clf.predict(extract_features_batch(windows, rec.fs))
+    edge = forest.predict(edge_features(codes))
+    return float(np.mean(full == edge))
+
+
+def main() -> None:
+    import joblib
+
+    parser = argparse.ArgumentParser(
+        description="Export a pruned, quantized forest as C tables for the EEG_EDGE firmware."
+    )
+    parser.add_argument("model", help="Path to the joblib-pickled model.")
+    parser.add_argument("--out", default=EDGE_HEADER_PATH, help="Output C header.")
+    parser.add_argument("--trees", type=int, default=5, help="Trees to keep.")
+    parser.add_argument("--depth", type=int, default=5, help="Maximum tree depth.")
+    parser.add_argument("--fs", type=float, default=DEFAULT_FS, help="Firmware sample rate (Hz).")
+    parser.add_argument("--window-seconds", type=float, default=3.0)
+    parser.add_argument(
+        "--volts-per-code",
+        type=float,
+        default=VOLTS_PER_CODE,
+        help="ADC scale the thresholds are quantized to.",
+    )
+    parser.add_argument(
+        "--check",
+        action="append",
+        default=[],
+        metavar="RECORDING",
+        help="Report edge vs. full model agreement on a recording; may be repeated.",
+    )
+    args = parser.parse_args()
+
+    clf = joblib.load(args.model)
+    forest = build_edge_forest(clf, args.trees, args.depth, args.volts_per_code)
+    try:
+        write_header(forest, args.out, args.fs, args.window_seconds, source=args.model)
+    except ValueError as exc:
+        print(f"[ERROR] {exc}", file=sys.stderr)
+        sys.exit(1)
+    print(
+        f"[INFO] Exported {forest.n_trees} trees / {forest.n_nodes} nodes to {args.out} "
+        f"(mean training mass lost to pruned splits {100.0 * forest.lost.mean():.1f}%)"
+    )
+    for path in args.check:
+        agree = check_agreement(clf, forest, path, args.window_seconds, args.volts_per_code)
+        print(f"[INFO] {path}: edge model agrees with full model on {100.0 * agree:.1f}% of windows")
+
+
+__all__ = [
+    "EdgeForest",
+    "build_edge_forest",
+    "edge_features",
+    "quantize",
+    "write_header",
+    "EDGE_FEATURES",
+    "EDGE_HEADER_PATH",
+]
+
+
+if __name__ == "__main__":
+    main()
@@ -9,10 +9,19 @@ inside the GUI.
 
 from __future__ import annotations
 
-from typing import Iterable, Tuple
+import os
+from concurrent.futures import ThreadPoolExecutor
+from functools import lru_cache
+from typing import Dict, Iterable, Optional, Tuple
 
 import numpy as np
 
+try:
+    # Optional C++ feature engine (see eeg_native.cpp for the build line)
+    import eeg_native
+except ImportError:
+    eeg_native = None
+
 
 DEFAULT_FS = 100.0  # Hz, approximate sampling rate from Arduino sketch (delay(10))
 
@@ -41,6 +50,137 @@ def _bandpower(
     return float(np.trapz(fft_vals[idx], freqs[idx]))
 
 
+# Simple EEG frequency bands (Hz), in feature-vector order
+BANDS: Tuple[Tuple[str, Tuple[float, float]], ...] = (
+    ("delta", (0.5, 4.0)),
+    ("theta", (4.0, 8.0)),
+    ("alpha", (8.0, 13.0)),
+    ("beta", (13.0, 30.0)),
+)
+
+N_FEATURES = 5 + len(BANDS)
+
+
+class SpectralPlan:
+    """
+    Everything about the band powers that depends only on (n, fs, bands).
+
+    Built once per configuration by `spectral_plan` and shared by the
+    single-window, batch, incremental and Welch paths (and so by the
+    training script):
+
+        freqs    rfft bin frequencies of an n-sample window
+        weights  (n_bands, n // 2 + 1) trapezoid weights; each row
+                 reproduces np.trapz over the bins `_bandpower` selects,
+                 so one FFT yields every band
+        slices   (start, stop, weights) per band, the contiguous bin range
+                 carrying that band's weight
+        bins     indices of all bins with any band weight
+        native   eeg_native.FeaturePlan over the same slices (FFT plan
+                 included), or None when the extension is not built
+
+    NumPy's pocketfft keeps no reusable plan object of its own; it caches
+    its twiddle factors per length internally, so on the NumPy path only
+    the band tables are held here.
+    """
+
+    def __init__(
+        self,
+        n: int,
+        fs: float = DEFAULT_FS,
+        bands: Tuple[Tuple[str, Tuple[float, float]], ...] = BANDS,
+    ) -> None:
+        self.n = int(n)
+        self.fs = float(fs)
+        self.bands = bands
+        self.freqs = np.fft.rfftfreq(self.n, d=1.0 / self.fs)
+
+        weights = np.zeros((len(bands), self.freqs.size), dtype=float)
+        for row, (_name, (fmin, fmax)) in enumerate(bands):
+            idx = np.where((self.freqs >= fmin) & (self.freqs <= fmax))[0]
+            if idx.size < 2:
+                # np.trapz over fewer than two points integrates to zero
+                continue
+            dx = np.diff(self.freqs[idx])
+            weights[row, idx[:-1]] += 0.5 * dx
+            weights[row, idx[1:]] += 0.5 * dx
+
+        slices = []
+        for row in weights:
+            nz = np.flatnonzero(row)
+            if nz.size == 0:
+                slices.append((0, 0, row[:0]))
+            else:
+                lo, hi = int(nz[0]), int(nz[-1]) + 1
+                slices.append((lo, hi, row[lo:hi]))
+
+        self.weights = weights
+        self.slices: Tuple[Tuple[int, int, np.ndarray], ...] = tuple(slices)
+        self.bins = np.flatnonzero(weights.any(axis=0))
+        for arr in (self.freqs, self.weights, self.bins):
+            arr.setflags(write=False)
+        self.native = None
+        if eeg_native is not None:
+            self.native = eeg_native.FeaturePlan(
+                self.n, [(start, stop, w.tolist()) for start, stop, w in self.slices]
+            )
+
+    def band_powers(self, power: np.ndarray, out: np.ndarray) -> None:
+        """
+        Fill out[:, b] with band b's power from rfft powers of shape
+        (n_windows, n // 2 + 1).
+
+        Reducing a contiguous slice row by row keeps the summation order
+        the same for one window or many, which the batch path relies on.
+        """
+        for col, (start, stop, w) in enumerate(self.slices):
+            out[:, col] = (power[:, start:stop] * w).sum(axis=1)
+
+
+@lru_cache(maxsize=32)
+def spectral_plan(
+    n: int,
+    fs: float = DEFAULT_FS,
+    bands: Tuple[Tuple[str, Tuple[float, float]], ...] = BANDS,
+) -> SpectralPlan:
+    """Shared SpectralPlan for one (n, fs, bands) configuration."""
+    return SpectralPlan(n, fs, bands)
+
+
+def _features_2d(X: np.ndarray, fs: float, out: np.ndarray) -> None:
+    """
+    Fill out[i] with the feature vector of window X[i].
+
+    Uses the native engine when it is built, else `_features_2d_numpy`.
+    Both compute each row on its own, so a row's result does not depend
+    on which other rows it is computed with; they agree to rounding.
+    """
+    native = spectral_plan(X.shape[1], float(fs)).native
+    if native is None:
+        _features_2d_numpy(X, fs, out)
+    else:
+        # Releases the GIL, so the batch thread pool runs it in parallel
+        native.features(X, out)
+
+
+def _features_2d_numpy(X: np.ndarray, fs: float, out: np.ndarray) -> None:
+    """NumPy implementation of `_features_2d`; reduces along axis 1 only."""
+    mean = X.mean(axis=1)
+    xc = X - mean[:, None]
+    xmin = X.min(axis=1)
+    xmax = X.max(axis=1)
+    out[:, 0] = mean
+    out[:, 1] = np.sqrt((xc * xc).mean(axis=1))
+    out[:, 2] = xmin
+    out[:, 3] = xmax
+    out[:, 4] = xmax - xmin
+
+    # Band powers: one FFT per window, each band a weighted slice sum
+    spec = np.fft.rfft(xc, axis=1)
+    power = spec.real * spec.real + spec.imag * spec.imag
+    spectral_plan(X.shape[1], float(fs)).band_powers(power, out[:, 5:])
+
+
 def extract_features(
     signal: Iterable[float],
     fs: float = DEFAULT_FS,
@@ -51,42 +191,381 @@ def extract_features(
     Features:
         - mean, std, min, max, max-min
         - band power in delta, theta, alpha, beta ranges
+
+    The mean is computed once and reused for std and the DC removal,
+    and all four band powers come from a single rfft. The result equals
+    the matching row of `extract_features_batch` to rounding (native
+    engine or NumPy, see `_features_2d`).
     """
-    x = np.asarray(list(signal), dtype=float)
+    if hasattr(signal, "__len__"):
+        x = np.asarray(signal, dtype=float)
+    else:
+        x = np.fromiter(signal, dtype=float)
+    x = x.ravel()
+    feats = np.zeros((1, N_FEATURES), dtype=float)
     if x.size == 0:
         # Return zeros with the expected feature length
-        return np.zeros(9, dtype=float)
-
-    # Time-domain statistics
-    mean = float(np.mean(x))
-    std = float(np.std(x))
-    xmin = float(np.min(x))
-    xmax = float(np.max(x))
-    peak_to_peak = xmax - xmin
-
-    # Simple EEG frequency bands (Hz)
-    delta = _bandpower(x, fs, (0.5, 4.0))
-    theta = _bandpower(x, fs, (4.0, 8.0))
-    alpha = _bandpower(x, fs, (8.0, 13.0))
-    beta = _bandpower(x, fs, (13.0, 30.0))
-
-    feats = np.array(
-        [
-            mean,
-            std,
-            xmin,
-            xmax,
-            peak_to_peak,
-            delta,
-            theta,
-            alpha,
-            beta,
-        ],
-        dtype=float,
-    )
-    return feats
-
-
-__all__ = ["extract_features", "DEFAULT_FS"]
+        return feats[0]
+
+    _features_2d(x[None, :], fs, feats)
+    return feats[0]
+
+
+def extract_features_batch(
+    X: np.ndarray,
+    fs: float = DEFAULT_FS,
+    chunk_rows: int = 4096,
+    workers: Optional[int] = None,
+) -> np.ndarray:
+    """
+    Feature vectors for many equal-length segments at once.
+
+    X has shape (n_segments, n_samples); the result has shape
+    (n_segments, N_FEATURES). Inputs larger than `chunk_rows` are split
+    into row chunks spread over a thread pool (NumPy's FFT and ufunc
+    loops release the GIL), which also bounds the temporary memory.
+    """
+    # Row-contiguous so every row reduces exactly like a 1D window
+    X = np.ascontiguousarray(X, dtype=float)
+    if X.ndim != 2:
+        raise ValueError("X must have shape (n_segments, n_samples)")
+    out = np.zeros((X.shape[0], N_FEATURES), dtype=float)
+    if X.shape[0] == 0 or X.shape[1] == 0:
+        return out
+
+    if X.shape[0] <= chunk_rows:
+        _features_2d(X, fs, out)
+        return out
+
+    bounds = range(0, X.shape[0], chunk_rows)
+    n_workers = workers or min(os.cpu_count() or 1, len(bounds))
+    with ThreadPoolExecutor(max_workers=n_workers) as pool:
+        jobs = [
+            pool.submit(_features_2d, X[i : i + chunk_rows], fs, out[i : i + chunk_rows])
+            for i in bounds
+        ]
+        for job in jobs:
+            job.result()
+    return out
+
+
+def extract_features_multichannel(
+    X: np.ndarray,
+    fs: float = DEFAULT_FS,
+) -> np.ndarray:
+    """
+    Concatenated per-channel feature vectors.
+
+    X has shape (..., channels, n_samples), e.g. (channels, n) for one
+    multi-channel window or (n_windows, channels, n) for many. All
+    channel windows go through one `extract_features_batch` call (one
+    batched FFT) and the result has shape (..., channels * N_FEATURES),
+    channel 0's features first.
+    """
+    X = np.asarray(X, dtype=float)
+    if X.ndim < 2:
+        raise ValueError("X must have shape (..., channels, n_samples)")
+    lead = X.shape[:-2]
+    channels, n = X.shape[-2:]
+    feats = extract_features_batch(X.reshape(-1, n), fs=fs)
+    return feats.reshape(*lead, channels * N_FEATURES)
+
+
+def log_band_powers(X: np.ndarray) -> np.ndarray:
+    """
+    log10 of the band-power columns of (multi-channel) feature rows.
+
+    Lives here rather than in train_classifier so models that wrap it in
+    a FunctionTransformer unpickle in the GUI and batch tools.
+    """
+    X = np.asarray(X)
+    cols = [i for i in range(X.shape[1]) if i % N_FEATURES >= 5]
+    return np.log10(X[:, cols] + 1e-12)
+
+
+class IncrementalFeatures:
+    """
+    Sliding-window counterpart of `extract_features` for streaming input.
+
+    Keeps the last `window` samples in a ring, running sums for mean/std
+    and sliding-DFT accumulators for only the rfft bins that carry band
+    weight. `push` costs O(bins) per new sample however long the window
+    is; `features` returns the same 9-element vector as
+    `extract_features` on the current window once `ready` is True.
+
+    Accumulators are re-seeded from the ring every `resync_every` samples
+    (one window by default) so rounding drift stays bounded.
+    """
+
+    def __init__(
+        self,
+        window: int,
+        fs: float = DEFAULT_FS,
+        resync_every: Optional[int] = None,
+    ) -> None:
+        if window < 2:
+            raise ValueError("window must be at least 2 samples")
+        self.window = int(window)
+        self.fs = float(fs)
+        self._resync_every = int(resync_every) if resync_every else self.window
+
+        plan = spectral_plan(self.window, self.fs)
+        self._bins = plan.bins
+        self._weights = plan.weights[:, self._bins]
+        # Per-sample phase advance of each tracked bin
+        self._phase = 2.0 * np.pi * self._bins / self.window
+
+        self._ring = np.zeros(self.window, dtype=float)
+        self.reset()
+
+    def reset(self) -> None:
+        """Forget all samples pushed so far."""
+        self._ring.fill(0.0)
+        self._pos = 0  # next write index (oldest sample once full)
+        self._count = 0
+        self._since_sync = 0
+        self._spec = np.zeros(self._bins.size, dtype=complex)
+        # Running sums are kept relative to an offset to limit cancellation
+        self._offset = 0.0
+        self._sum = 0.0
+        self._sumsq = 0.0
+
+    @property
+    def ready(self) -> bool:
+        """True once a full window of samples has been pushed."""
+        return self._count >= self.window
+
+    @property
+    def count(self) -> int:
+        """Total number of samples pushed since the last reset."""
+        return self._count
+
+    def push(self, samples: Iterable[float]) -> None:
+        """Slide the window forward over a block of new samples."""
+        x = np.asarray(samples, dtype=float).ravel()
+        m = x.size
+        if m == 0:
+            return
+
+        if m >= self.window:
+            # The whole window is replaced; cheaper to re-seed directly
+            self._ring[:] = x[-self.window :]
+            self._pos = 0
+            self._count += m
+            self._resync()
+            return
+
+        if self._count == 0:
+            self._offset = float(x[0])
+
+        n_filled = min(self._count, self.window)
+        idx = (self._pos + np.arange(m)) % self.window
+        old = self._ring[idx]
+        self._ring[idx] = x
+        self._pos = (self._pos + m) % self.window
+        self._count += m
+
+        # Unfilled slots hold zeros: right for the DFT, not for the sums
+        evicted = max(0, n_filled + m - self.window)
+        old_real = old[m - evicted :] - self._offset
+        xs = x - self._offset
+        self._sum += float(xs.sum() - old_real.sum())
+        self._sumsq += float(np.dot(xs, xs) - np.dot(old_real, old_real))
+
+        # X_k <- w^m X_k + sum_i w^(m - i) (x_i - old_i),  w = exp(j 2 pi k / N)
+        steps = np.arange(m, 0, -1, dtype=float)
+        twiddle = np.exp(1j * np.outer(self._phase, steps))
+        self._spec = self._spec * np.exp(1j * self._phase * m) + twiddle @ (x - old)
+
+        self._since_sync += m
+        if self._since_sync >= self._resync_every:
+            self._resync()
+
+    def _resync(self) -> None:
+        """Recompute all accumulators exactly from the ring contents."""
+        # Oldest first; unfilled (zero) slots come before the real samples
+        ordered = np.roll(self._ring, -self._pos)
+        n_filled = min(self._count, self.window)
+        real = ordered[self.window - n_filled :]
+
+        self._offset = float(real[0]) if real.size else 0.0
+        xs = real - self._offset
+        self._sum = float(xs.sum())
+        self._sumsq = float(np.dot(xs, xs))
+        self._spec = np.fft.rfft(ordered)[self._bins]
+        self._since_sync = 0
+
+    def features(self) -> np.ndarray:
+        """Feature vector for the current window (see `extract_features`)."""
+        feats = np.zeros(N_FEATURES, dtype=float)
+        n = min(self._count, self.window)
+        if n == 0:
+            return feats
+
+        real = self._ring if n == self.window else self._ring[:n]
+        mean_rel = self._sum / n
+        xmin = real.min()
+        xmax = real.max()
+        feats[0] = self._offset + mean_rel
+        feats[1] = np.sqrt(max(self._sumsq / n - mean_rel * mean_rel, 0.0))
+        feats[2] = xmin
+        feats[3] = xmax
+        feats[4] = xmax - xmin
+
+        power = self._spec.real * self._spec.real + self._spec.imag * self._spec.imag
+        feats[5:] = self._weights @ power
+        return feats
+
+
+@lru_cache(maxsize=16)
+def _welch_taper(segment: int, fs: float) -> Tuple[np.ndarray, np.ndarray]:
+    """
+    Periodic Hann taper and per-bin PSD scale for `segment`-sample FFTs.
+
+    The scale gives a one-sided power spectral density (V^2/Hz), as
+    scipy.signal.welch with scaling="density".
+    """
+    k = np.arange(segment, dtype=float)
+    taper = 0.5 - 0.5 * np.cos(2.0 * np.pi * k / segment)
+    scale = np.full(segment // 2 + 1, 2.0 / (fs * np.dot(taper, taper)))
+    scale[0] /= 2.0
+    if segment % 2 == 0:
+        scale[-1] /= 2.0
+    taper.setflags(write=False)
+    scale.setflags(write=False)
+    return taper, scale
+
+
+def _welch_segment_psd(segments: np.ndarray, fs: float) -> np.ndarray:
+    """PSD of each row of `segments` (mean-removed, Hann-tapered)."""
+    taper, scale = _welch_taper(segments.shape[-1], float(fs))
+    xc = segments - segments.mean(axis=-1, keepdims=True)
+    spec = np.fft.rfft(xc * taper, axis=-1)
+    return (spec.real * spec.real + spec.imag * spec.imag) * scale
+
+
+def welch_band_powers(
+    x: np.ndarray,
+    fs: float = DEFAULT_FS,
+    segment: Optional[int] = None,
+    overlap: float = 0.5,
+) -> np.ndarray:
+    """
+    Welch band powers of one window, in BANDS order.
+
+    The window is cut into `segment`-sample pieces every
+    `segment * (1 - overlap)` samples (half the window and 50 % by
+    default); their PSDs are averaged and integrated over each band.
+    Matches `WelchBandPower.band_powers` when the streaming window ends
+    on a segment boundary.
+    """
+    x = np.asarray(x, dtype=float).ravel()
+    segment = int(segment) if segment else max(x.size // 2, 2)
+    hop = max(int(segment * (1.0 - overlap)), 1)
+    if x.size < segment:
+        return np.zeros(len(BANDS), dtype=float)
+    n_segments = (x.size - segment) // hop + 1
+    # Drop the ragged head so segments end at the newest sample
+    start = x.size - ((n_segments - 1) * hop + segment)
+    frames = np.lib.stride_tricks.sliding_window_view(x[start:], segment)[::hop]
+    psd = _welch_segment_psd(frames, fs).mean(axis=0)
+    return spectral_plan(segment, float(fs)).weights @ psd
+
+
+class WelchBandPower:
+    """
+    Streaming Welch band-power estimator for heavily overlapping windows.
+
+    The stream is split into fixed `segment`-sample pieces starting every
+    `hop` samples (absolute sample positions, so the grid never moves).
+    Each piece's tapered FFT is computed exactly once, when its last
+    sample arrives, and kept in a small cache keyed by segment index;
+    `band_powers` averages the cached PSDs of the pieces inside the last
+    `window` samples. Sliding the window by a few samples therefore costs
+    at most one new segment FFT, and the averaged estimate has lower
+    variance than a single periodogram of the whole window.
+    """
+
+    def __init__(
+        self,
+        window: int,
+        fs: float = DEFAULT_FS,
+        segment: Optional[int] = None,
+        overlap: float = 0.5,
+    ) -> None:
+        self.window = int(window)
+        self.fs = float(fs)
+        self.segment = int(segment) if segment else max(self.window // 2, 2)
+        if not 2 <= self.segment <= self.window:
+            raise ValueError("segment must be between 2 and window samples")
+        if not 0.0 <= overlap < 1.0:
+            raise ValueError("overlap must be in [0, 1)")
+        self.hop = max(int(self.segment * (1.0 - overlap)), 1)
+        self._weights = spectral_plan(self.segment, self.fs).weights
+        self.reset()
+
+    def reset(self) -> None:
+        """Forget all samples and cached spectra."""
+        self._count = 0
+        self._next_start = 0  # absolute start of the next segment to compute
+        self._tail = np.zeros(0, dtype=float)  # samples from _next_start on
+        self._cache: Dict[int, np.ndarray] = {}  # segment index -> PSD
+
+    @property
+    def count(self) -> int:
+        return self._count
+
+    @property
+    def ready(self) -> bool:
+        """True once at least one segment lies inside the window."""
+        return bool(self._cache)
+
+    def push(self, samples: Iterable[float]) -> None:
+        x = np.asarray(samples, dtype=float).ravel()
+        if x.size == 0:
+            return
+        tail = np.concatenate((self._tail, x))
+        self._count += x.size
+
+        # All segments completed by this block, in one batched FFT
+        available = tail.size - self.segment
+        if available >= 0:
+            n_new = available // self.hop + 1
+            frames = np.lib.stride_tricks.sliding_window_view(tail, self.segment)
+            psd = _welch_segment_psd(frames[: n_new * self.hop : self.hop], self.fs)
+            first = self._next_start // self.hop
+            for i, row in enumerate(psd):
+                self._cache[first + i] = row
+            self._next_start += n_new * self.hop
+            tail = tail[n_new * self.hop :]
+        self._tail = tail
+
+        # Evict segments that have slid out of the window
+        oldest = self._count - self.window
+        for index in [i for i in self._cache if i * self.hop < oldest]:
+            del self._cache[index]
+
+    def band_powers(self) -> np.ndarray:
+        """Band powers (BANDS order) averaged over the cached segments."""
+        if not self._cache:
+            return np.zeros(len(BANDS), dtype=float)
+        psd = np.mean(list(self._cache.values()), axis=0)
+        return self._weights @ psd
+
+
+__all__ = [
+    "extract_features",
+    "extract_features_batch",
+    "extract_features_multichannel",
+    "log_band_powers",
+    "IncrementalFeatures",
+    "WelchBandPower",
+    "welch_band_powers",
+    "SpectralPlan",
+    "spectral_plan",
+    "BANDS",
+    "N_FEATURES",
+    "DEFAULT_FS",
+]
 
 
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""
+Streaming notch + bandpass filter stage for EEG samples.
+
+Mains pickup and electrode drift otherwise go straight into the band
+powers and the rule thresholds. The stage is one cascade of
+second-order sections (SOS):
+
+    - Butterworth bandpass, BANDPASS_HZ (0.5-30 Hz by default)
+    - IIR notch at MAINS_HZ, when it lies below Nyquist
+
+`StreamingFilter` keeps the SOS state between blocks, so every sample is
+filtered exactly once and a whole block costs a single `sosfilt` call.
+`filter_signal` applies the identical stage offline (training), starting
+from the same initial state, so live and offline features agree.
+
+By default the output keeps the level of the first sample
+(`keep_level`): the bandpass removes DC, and adding that constant back
+leaves voltages in the range the plots and `classify_by_rules`
+thresholds expect while drift and mains are still removed.
+"""
+
+from __future__ import annotations
+
+from functools import lru_cache
+from typing import Optional, Tuple
+
+import numpy as np
+from scipy import signal
+
+from eeg_features import DEFAULT_FS
+
+
+MAINS_HZ = 50.0  # 60.0 in the Americas
+NOTCH_Q = 30.0
+BANDPASS_HZ: Tuple[float, float] = (0.5, 30.0)
+BANDPASS_ORDER = 4
+
+
+@lru_cache(maxsize=16)
+def design_sos(
+    fs: float = DEFAULT_FS,
+    mains: Optional[float] = MAINS_HZ,
+    band: Tuple[float, float] = BANDPASS_HZ,
+    order: int = BANDPASS_ORDER,
+) -> np.ndarray:
+    """
+    SOS coefficients for the bandpass followed by the mains notch.
+
+    A notch at or above Nyquist is left out (at fs = 100 Hz, 50 Hz sits
+    exactly on Nyquist and is already far inside the bandpass stopband);
+    a bandpass edge at or above Nyquist degrades it to a highpass.
+    """
+    nyquist = fs / 2.0
+    low, high = band
+    if high < nyquist:
+        sections = [signal.butter(order, (low, high), btype="bandpass", fs=fs, output="sos")]
+    else:
+        sections = [signal.butter(order, low, btype="highpass", fs=fs, output="sos")]
+    if mains is not None and 0.0 < mains < nyquist:
+        b, a = signal.iirnotch(mains, NOTCH_Q, fs=fs)
+        sections.append(signal.tf2sos(b, a))
+    sos = np.concatenate(sections, axis=0)
+    sos.setflags(write=False)
+    return sos
+
+
+def _initial_state(sos: np.ndarray, first: np.ndarray) -> np.ndarray:
+    """
+    Steady-state SOS state for a signal that starts at `first`.
+
+    `first` has the shape of one sample along the filtered (last) axis,
+    i.e. x[..., :1]; the result has shape (n_sections, ..., 2) as
+    `sosfilt(..., axis=-1, zi=...)` expects.
+    """
+    zi = signal.sosfilt_zi(sos)
+    zi = zi.reshape(zi.shape[0], *([1] * (first.ndim - 1)), 2)
+    return zi * first[None, ...]
+
+
+def filter_signal(
+    x: np.ndarray,
+    fs: float = DEFAULT_FS,
+    axis: int = -1,
+    keep_level: bool = True,
+    mains: Optional[float] = MAINS_HZ,
+) -> np.ndarray:
+    """
+    Filter whole signals along `axis` with the streaming stage.
+
+    Every 1D slice (e.g. every row of an (n_segments, n_samples) batch)
+    is filtered independently, in one vectorized `sosfilt` call, and
+    gives the same result as pushing it through a fresh StreamingFilter.
+    """
+    sos = design_sos(float(fs), mains)
+    xm = np.moveaxis(np.asarray(x, dtype=float), axis, -1)
+    if xm.shape[-1] == 0:
+        return np.moveaxis(xm.copy(), -1, axis)
+    first = xm[..., :1]
+    y, _ = signal.sosfilt(sos, xm, axis=-1, zi=_initial_state(sos, first))
+    if keep_level:
+        y += first
+    return np.moveaxis(y, -1, axis)
+
+
+class StreamingFilter:
+    """
+    Stateful block filter placed between the serial reader and the ring.
+
+    `process` takes blocks of shape (n,) or, with `channels` set,
+    (n, channels), as they come from the parsers and the frame decoder,
+    and returns filtered blocks of the same shape. State is primed from
+    the first sample so there is no start-up step transient.
+    """
+
+    def __init__(
+        self,
+        fs: float = DEFAULT_FS,
+        channels: Optional[int] = None,
+        keep_level: bool = True,
+        mains: Optional[float] = MAINS_HZ,
+    ) -> None:
+        self.fs = float(fs)
+        self.channels = channels
+        self.keep_level = keep_level
+        self.sos = design_sos(self.fs, mains)
+        self._zi: Optional[np.ndarray] = None
+        self._level: Optional[np.ndarray] = None
+
+    def reset(self) -> None:
+        """Forget the filter state; the next block re-primes it."""
+        self._zi = None
+        self._level = None
+
+    def process(self, block: np.ndarray) -> np.ndarray:
+        x = np.asarray(block, dtype=float)
+        if self.channels is not None:
+            x = x.reshape(-1, self.channels)
+        if x.shape[0] == 0:
+            return x.copy()
+
+        # Filter along time as the last axis: (n,) or (channels, n)
+        xt = x.T
+        if self._zi is None:
+            first = xt[..., :1]
+            self._zi = _initial_state(self.sos, first)
+            self._level = first.copy() if self.keep_level else np.zeros_like(first)
+        y, self._zi = signal.sosfilt(self.sos, xt, axis=-1, zi=self._zi)
+        y += self._level
+        return y.T
+
+
+__all__ = [
+    "StreamingFilter",
+    "filter_signal",
+    "design_sos",
+    "MAINS_HZ",
+    "BANDPASS_HZ",
+]
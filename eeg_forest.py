@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+"""
+Flattened random-forest model for low-latency single-window prediction.
+
+sklearn's RandomForestClassifier.predict_proba pays its validation,
+joblib dispatch and per-tree Python overhead on every call, which
+dominates when the GUI classifies one window at a time. Here all trees
+are packed into one set of contiguous node arrays:
+
+    feature[i]    feature index tested at node i
+    threshold[i]  go left when x[feature[i]] <= threshold[i]
+    left[i]       absolute index of the left child
+    right[i]      absolute index of the right child
+    value[i]      class probabilities at node i (used at leaves)
+    roots[t]      index of the root node of tree t
+
+Leaves point back to themselves (threshold +inf), so evaluation is a
+fixed number of branch-free steps over all trees at once: the same
+layout can be emitted as C tables for firmware. When the eeg_native
+extension is built, predict_proba walks each tree to its leaf in C++
+instead (see eeg_native.cpp).
+
+Export an existing model with:
+    python eeg_forest.py models/eeg_state_model.pkl
+"""
+
+from __future__ import annotations
+
+import argparse
+import os
+from dataclasses import dataclass, field
+from typing import Any, Dict
+
+import numpy as np
+
+try:
+    # Optional C++ evaluator (see eeg_native.cpp for the build line)
+    import eeg_native
+except ImportError:
+    eeg_native = None
+
+
+FOREST_PATH = os.path.join("models", "eeg_state_forest.npz")
+
+
+@dataclass
+class FlatForest:
+    feature: np.ndarray  # int32 (n_nodes,)
+    threshold: np.ndarray  # float64 (n_nodes,)
+    left: np.ndarray  # int32 (n_nodes,)
+    right: np.ndarray  # int32 (n_nodes,)
+    value: np.ndarray  # float64 (n_nodes, n_classes)
+    roots: np.ndarray  # int32 (n_trees,)
+    classes: np.ndarray  # (n_classes,)
+    max_depth: int
+    # eeg_native.ForestEvaluator over the arrays above, built on first use
+    _native: Any = field(default=None, init=False, repr=False, compare=False)
+
+    @property
+    def n_trees(self) -> int:
+        return int(self.roots.size)
+
+    @property
+    def n_nodes(self) -> int:
+        return int(self.feature.size)
+
+    @property
+    def classes_(self) -> np.ndarray:
+        """Alias matching sklearn estimators."""
+        return self.classes
+
+    def predict_proba(self, X: np.ndarray) -> np.ndarray:
+        """
+        Class probabilities for each row of X, shape (n_rows, n_classes).
+
+        Matches the forest's predict_proba: features are compared in
+        float32 like sklearn's trees, and leaf distributions are averaged
+        over trees. The native and NumPy paths agree to rounding.
+        """
+        X = np.asarray(X, dtype=np.float32)
+        if X.ndim == 1:
+            X = X[None, :]
+        if eeg_native is None:
+            return self._predict_proba_numpy(X)
+        if self._native is None:
+            self._native = eeg_native.ForestEvaluator(
+                self.feature,
+                self.threshold,
+                self.left,
+                self.right,
+                self.value,
+                self.roots,
+                self.max_depth,
+            )
+        return self._native.predict_proba(X)
+
+    def _predict_proba_numpy(self, X: np.ndarray) -> np.ndarray:
+        """NumPy implementation of `predict_proba` for a 2D float32 X."""
+        rows = np.arange(X.shape[0])[:, None]
+        nodes = np.broadcast_to(self.roots, (X.shape[0], self.n_trees))
+        for _ in range(self.max_depth):
+            go_left = X[rows, self.feature[nodes]] <= self.threshold[nodes]
+            nodes = np.where(go_left, self.left[nodes], self.right[nodes])
+        return self.value[nodes].mean(axis=1)
+
+    def __getstate__(self) -> Dict[str, Any]:
+        # The evaluator does not pickle (the model is sent to the
+        # inference process); the copy rebuilds it on first use
+        state = self.__dict__.copy()
+        state["_native"] = None
+        return state
+
+    def predict(self, X: np.ndarray) -> np.ndarray:
+        return self.classes[np.argmax(self.predict_proba(X), axis=1)]
+
+    def save(self, path: str = FOREST_PATH) -> None:
+        os.makedirs(os.path.dirname(path) or ".", exist_ok=True)
+        np.savez(
+            path,
+            feature=self.feature,
+            threshold=self.threshold,
+            left=self.left,
+            right=self.right,
+            value=self.value,
+            roots=self.roots,
+            classes=self.classes,
+            max_depth=np.array(self.max_depth),
+        )
+
+    @classmethod
+    def load(cls, path: str = FOREST_PATH) -> "FlatForest":
+        with np.load(path, allow_pickle=False) as data:
+            return cls(
+                feature=data["feature"],
+                threshold=data["threshold"],
+                left=data["left"],
+                right=data["right"],
+                value=data["value"],
+                roots=data["roots"],
+                classes=data["classes"],
+                max_depth=int(data["max_depth"]),
+            )
+
+
+def flatten_forest(clf: Any) -> FlatForest:
+    """Pack a fitted sklearn forest (or single tree) into a FlatForest."""
+    estimators = getattr(clf, "estimators_", [clf])
+    features, thresholds, lefts, rights, values, roots = [], [], [], [], [], []
+    offset = 0
+    max_depth = 0
+    for est in estimators:
+        tree = est.tree_
+        n = tree.node_count
+        left = tree.children_left.astype(np.int32)
+        right = tree.children_right.astype(np.int32)
+        leaf = left < 0
+        idx = np.arange(n, dtype=np.int32)
+
+        # Leaves loop onto themselves so extra steps are no-ops
+        features.append(np.where(leaf, 0, tree.feature).astype(np.int32))
+        thresholds.append(np.where(leaf, np.inf, tree.threshold))
+        lefts.append(np.where(leaf, idx, left) + offset)
+        rights.append(np.where(leaf, idx, right) + offset)
+
+        # Per-node class distribution, normalized whether sklearn stores
+        # weighted counts or fractions
+        value = tree.value[:, 0, :].astype(float)
+        totals = value.sum(axis=1, keepdims=True)
+        values.append(value / np.where(totals > 0, totals, 1.0))
+
+        roots.append(offset)
+        offset += n
+        max_depth = max(max_depth, int(tree.max_depth))
+
+    return FlatForest(
+        feature=np.concatenate(features),
+        threshold=np.concatenate(thresholds).astype(np.float64),
+        left=np.concatenate(lefts).astype(np.int32),
+        right=np.concatenate(rights).astype(np.int32),
+        value=np.concatenate(values, axis=0),
+        roots=np.array(roots, dtype=np.int32),
+        classes=np.asarray(clf.classes_),
+        max_depth=max_depth,
+    )
+
+
+def main() -> None:
+    import joblib
+
+    parser = argparse.ArgumentParser(
+        description="Export a trained sklearn forest to flat node arrays."
+    )
+    parser.add_argument("model", help="Path to the joblib-pickled model.")
+    parser.add_argument("--out", default=FOREST_PATH, help="Output .npz path.")
+    args = parser.parse_args()
+
+    forest = flatten_forest(joblib.load(args.model))
+    forest.save(args.out)
+    print(
+        f"[INFO] Exported {forest.n_trees} trees / {forest.n_nodes} nodes "
+        f"(max depth {forest.max_depth}) to {args.out}"
+    )
+
+
+__all__ = ["FlatForest", "flatten_forest", "FOREST_PATH"]
+
+
+if __name__ == "__main__":
+    main()
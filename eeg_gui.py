@@ -18,9 +18,8 @@ import re
 import sys
 import threading
 import time
-from collections import deque
 from datetime import datetime
-from typing import Deque, Optional, Tuple, List, Any
+from typing import Any, Dict, List, Optional, Tuple
 
 import matplotlib
 
@@ -36,7 +35,7 @@ from matplotlib.figure import Figure  # noqa: E402
 
 import joblib  # noqa: E402
 
-from PyQt5.QtCore import QTimer, Qt  # noqa: E402
+from PyQt5.QtCore import QObject, QTimer, Qt, pyqtSignal  # noqa: E402
 from PyQt5.QtWidgets import (  # noqa: E402
     QApplication,
     QFileDialog,
@@ -50,45 +49,123 @@ from PyQt5.QtWidgets import (  # noqa: E402
     QAbstractItemView,
     QFrame,
     QCheckBox,
+    QComboBox,
 )
 from PyQt5.QtGui import QPixmap, QFont  # noqa: E402
 
-from eeg_features import extract_features, DEFAULT_FS
+from eeg_buffer import RingBuffer
+from eeg_decimate import MinMaxPyramid, decimated_x, minmax_decimate
+from eeg_protocol import ARDUINO_PROFILE, DeviceProfile, FrameDecoder, FrameFormat
+from eeg_recording import BINARY_EXT, BinaryRecorder, CsvRecorder, open_recording
+from eeg_replay import ReplayReader
+from eeg_features import IncrementalFeatures, extract_features_multichannel, DEFAULT_FS
+from eeg_filters import StreamingFilter
+from eeg_forest import FOREST_PATH, FlatForest
+from eeg_metrics import Metrics
+from eeg_multiproc import ProcessPipeline
 
 
 SERIAL_PORT = "/dev/cu.usbmodem214101"
-BAUD_RATE = 9600
+# Sample rate and ADC scale of the device; eeg_protocol.frontend_profile(rate,
+# gain) for the calculator.c EEG_FRONTEND board, set to what its LCD shows.
+# train_classifier.py assumes DEFAULT_FS, so other rates need a model
+# trained on recordings made at that rate.
+DEVICE_PROFILE = ARDUINO_PROFILE
+# "text": ASCII lines ("Raw: 1425\tVoltage: 1.87"), "binary": eeg_protocol frames
+SERIAL_PROTOCOL = "text"
+BAUD_RATE = 9600 if SERIAL_PROTOCOL == "text" else 115200
+# ADS1115 channels sent by the device; >1 switches to the multi-channel
+# pipeline (text lines then carry one comma-separated voltage per channel)
+CHANNELS = 1
+FRAME_FORMAT = FrameFormat(channels=CHANNELS, samples=8)
 SAMPLES_TO_SHOW = 500
+PLOT_INTERVAL_MS = 16  # ~60 fps; only the live line is redrawn per frame
+# Live y-limits only move when data leaves them or fills less than this share
+LIVE_YLIM_SHRINK = 0.25
+# Ring capacity; headroom over SAMPLES_TO_SHOW so the reader cannot lap a frame
+BUFFER_CAPACITY = 4 * SAMPLES_TO_SHOW
 READ_TIMEOUT = 1.0
 DATA_DIR = "data"
+# "binary": columnar .eegrec recordings (memory-mapped on load), "csv": text logs
+RECORDING_FORMAT = "binary"
 MODEL_DIR = "models"
 MODEL_PATH = os.path.join(MODEL_DIR, "eeg_state_model.pkl")
 CLASS_NAMES = {0: "Relaxed", 1: "Focused", 2: "Sleepy"}
 CLASS_COLORS = {0: "green", 1: "blue", 2: "orange"}
 WINDOW_SECONDS = 3.0  # seconds of data used for classification (moving average)
+CLASSIFY_INTERVAL = 0.25  # seconds between classification ticks
+# Notch + bandpass stage in front of the ring buffer (see eeg_filters);
+# recordings always keep the unfiltered samples
+LIVE_FILTER = True
+TEXT_FILTER_BLOCK = 8  # text-mode samples filtered per block
+REPLAY_SPEED = 1.0  # "Replay" button: x real time, 0 = as fast as possible
+STATS_INTERVAL_MS = 1000  # stats panel refresh
+# Prometheus textfile export of the pipeline metrics, refreshed with the
+# stats panel; None disables it
+METRICS_PATH: Optional[str] = None
+# Run acquisition and classification in their own processes around a
+# shared-memory ring (see eeg_multiproc); the GUI process only plots
+MULTIPROCESS = False
+_NUMBER_RE = re.compile(r"[+-]?\d*\.?\d+")
 
 
 class SerialReader(threading.Thread):
     """
     Background thread that reads samples from the serial port and
     pushes them into a fixed-length buffer and CSV log.
+
+    This thread is the single producer of `buffer`. With channels > 1
+    every sample is a vector with one value per channel, parsed in one
+    pass and pushed into a multi-channel (structure-of-arrays) ring.
+
+    With `live_filter` the samples pass through a StreamingFilter on the
+    way into the buffer, one block at a time; the log gets them unfiltered.
+    `profile` gives the sample rate (filter design, log timestamps and
+    header) and the scale of binary-mode codes.
+    Throughput and error counts go to `metrics`.
     """
 
     def __init__(
         self,
         port: str,
         baud_rate: int,
-        buffer: Deque[float],
+        buffer: RingBuffer,
         stop_event: threading.Event,
-        csv_path: str,
+        record_path: str,
+        protocol: str = SERIAL_PROTOCOL,
+        channels: int = CHANNELS,
+        live_filter: bool = LIVE_FILTER,
+        metrics: Optional[Metrics] = None,
+        profile: DeviceProfile = DEVICE_PROFILE,
     ) -> None:
         super().__init__(daemon=True)
+        if protocol not in ("text", "binary"):
+            raise ValueError(f"Unknown serial protocol: {protocol!r}")
         self._port = port
         self._baud_rate = baud_rate
         self._buffer = buffer
         self._stop_event = stop_event
-        self._csv_path = csv_path
+        self._record_path = record_path
+        self._protocol = protocol
+        self._channels = int(channels)
+        self._profile = profile
+        self._filter: Optional[StreamingFilter] = None
+        if live_filter:
+            self._filter = StreamingFilter(
+                profile.fs, channels=self._channels if self._channels > 1 else None
+            )
         self._ser: Optional[serial.Serial] = None
+        self.recorder: Optional[Any] = None
+
+        metrics = metrics if metrics is not None else Metrics()
+        self._bytes = metrics.counter("serial_bytes", "Bytes read from the serial port")
+        self._samples = metrics.counter("samples_parsed", "Samples published to the buffer")
+        self._failures = metrics.counter(
+            "parse_failures", "Unparseable lines or corrupt binary frames"
+        )
+        self._dropped = metrics.counter(
+            "dropped_frames", "Binary frames lost, from sequence number gaps"
+        )
 
     def run(self) -> None:
         try:
@@ -105,41 +182,135 @@ class SerialReader(threading.Thread):
 
         print(f"[INFO] Reading from {self._port} at {self._baud_rate} baud...")
 
-        # Open CSV file and write header
-        os.makedirs(os.path.dirname(self._csv_path), exist_ok=True)
-        with self._ser, open(self._csv_path, mode="w", newline="") as f:
-            writer = csv.writer(f)
-            writer.writerow(["timestamp_iso", "raw", "voltage"])
+        # Logging runs on its own thread so disk stalls never block reads
+        fs = self._profile.fs
+        if self._record_path.endswith(BINARY_EXT):
+            self.recorder = BinaryRecorder(
+                self._record_path,
+                volts_per_lsb=self._profile.volts_per_lsb,
+                fs=fs,
+                channels=self._channels,
+            )
+        else:
+            self.recorder = CsvRecorder(self._record_path, fs=fs, channels=self._channels)
+        self.recorder.start()
+        try:
+            with self._ser:
+                if self._protocol == "binary":
+                    self._read_binary(self.recorder)
+                else:
+                    self._read_text(self.recorder)
+        finally:
+            self.recorder.close()
 
-            while not self._stop_event.is_set():
-                try:
-                    line_bytes = self._ser.readline()
-                    if not line_bytes:
-                        continue
+        print(f"[INFO] SerialReader stopped. Log saved to {self._record_path}")
 
-                    line = line_bytes.decode(errors="ignore").strip()
-                    if not line:
-                        continue
+    def _push(self, volts: Any) -> None:
+        """Filter a block of samples (if enabled) and publish it."""
+        if self._filter is not None:
+            volts = self._filter.process(volts)
+        self._buffer.extend(volts)
+        self._samples.add(len(volts))
 
-                    parsed = self._parse_line(line)
-                    if parsed is None:
+    def _read_text(self, recorder: Any) -> None:
+        """
+        One ASCII sample per line, parsed by `_parse_line`.
+
+        Samples are published in blocks of TEXT_FILTER_BLOCK (or whatever
+        is pending when a read times out) so the filter runs per block.
+        """
+        pending: List[Any] = []
+        while not self._stop_event.is_set():
+            if len(pending) >= TEXT_FILTER_BLOCK:
+                self._push(pending)
+                pending = []
+            try:
+                line_bytes = self._ser.readline()
+                if not line_bytes:
+                    if pending:
+                        self._push(pending)
+                        pending = []
+                    continue
+                self._bytes.add(len(line_bytes))
+
+                line = line_bytes.decode(errors="ignore").strip()
+                if not line:
+                    continue
+
+                if self._channels > 1:
+                    values = self._parse_channels(line, self._channels)
+                    if values is None:
+                        self._failures.add()
                         continue
+                    pending.append(values)
+                    recorder.append(None, values)
+                    continue
 
-                    raw_value, voltage = parsed
-                    # Push voltage into buffer for plotting
-                    self._buffer.append(voltage)
-
-                    # Log to CSV with timestamp
-                    ts = datetime.utcnow().isoformat()
-                    writer.writerow([ts, raw_value, voltage])
-                except serial.SerialException as exc:
-                    print(f"[ERROR] Serial read error: {exc}", file=sys.stderr)
-                    break
-                except UnicodeDecodeError:
-                    # Ignore malformed lines
+                parsed = self._parse_line(line)
+                if parsed is None:
+                    self._failures.add()
                     continue
 
-        print(f"[INFO] SerialReader stopped. Log saved to {self._csv_path}")
+                raw_value, voltage = parsed
+                # Stage voltage for the buffer (plotting / classification)
+                pending.append(voltage)
+
+                # Stage for the log writer (timestamped per block)
+                recorder.append(raw_value, voltage)
+            except serial.SerialException as exc:
+                print(f"[ERROR] Serial read error: {exc}", file=sys.stderr)
+                break
+            except UnicodeDecodeError:
+                # Ignore malformed lines
+                continue
+
+    def _read_binary(self, recorder: Any) -> None:
+        """Fixed-size eeg_protocol frames, decoded a whole chunk at a time."""
+        decoder = FrameDecoder(FRAME_FORMAT)
+        frame_size = FRAME_FORMAT.size
+        while not self._stop_event.is_set():
+            try:
+                # Block for at least one frame, then take everything queued
+                chunk = self._ser.read(max(self._ser.in_waiting, frame_size))
+            except serial.SerialException as exc:
+                print(f"[ERROR] Serial read error: {exc}", file=sys.stderr)
+                break
+            if not chunk:
+                continue
+            self._bytes.add(len(chunk))
+
+            crc_errors, dropped = decoder.crc_errors, decoder.dropped_frames
+            raw = decoder.feed(chunk)
+            self._failures.add(decoder.crc_errors - crc_errors)
+            self._dropped.add(decoder.dropped_frames - dropped)
+            if raw.size == 0:
+                continue
+
+            codes = raw[:, 0] if self._channels == 1 else raw
+            volts = codes * self._profile.volts_per_lsb
+            self._push(volts)
+
+            recorder.write_block(codes, np.round(volts, 5))
+
+        if decoder.crc_errors or decoder.dropped_frames:
+            print(
+                f"[WARN] Binary link: {decoder.crc_errors} bad frames, "
+                f"{decoder.dropped_frames} dropped frames",
+                file=sys.stderr,
+            )
+
+    @staticmethod
+    def _parse_channels(line: str, channels: int) -> Optional[np.ndarray]:
+        """
+        Parse one multi-channel line, e.g. "1.85,1.86,1.84,1.90".
+
+        All numeric tokens are taken in a single regex pass; lines with a
+        different number of values than `channels` are rejected.
+        """
+        tokens = _NUMBER_RE.findall(line)
+        if len(tokens) != channels:
+            return None
+        return np.array(tokens, dtype=float)
 
     @staticmethod
     def _parse_line(line: str) -> Optional[Tuple[Optional[int], float]]:
@@ -185,7 +356,174 @@ class SerialReader(threading.Thread):
         return raw_value, voltage
 
 
+def classify_by_rules(window: np.ndarray) -> int:
+    """
+    Rule-based fallback classifier on a raw voltage window.
+
+    More robust than a plain mean, using the activity ratio:
+        - Focused: strong activity, frequent peaks above ~1.9 V
+        - Relaxed: noticeable activity above 1.7 V, but weaker high peaks
+        - Sleepy: almost no time spent above 1.7 V
+    """
+    peak_v = float(np.max(window))
+    frac_above_17 = float(np.mean(window > 1.7))
+    frac_above_19 = float(np.mean(window > 1.9))
+
+    if frac_above_19 >= 0.15 or (peak_v >= 2.0 and frac_above_19 >= 0.05):
+        return 1
+    if frac_above_17 >= 0.10:
+        return 0
+    return 2
+
+
+class ClassificationWorker(QObject):
+    """
+    Classifies the latest window of every registered buffer off the Qt
+    main thread and posts results back through `result_ready`.
+
+    Each single-channel source keeps an IncrementalFeatures window that
+    is only fed the samples written since the previous tick; multi-channel
+    sources copy their latest (channels, window) block and featurize all
+    channels in one batched pass. All windows due at the same tick are
+    stacked into a single `predict_proba` call. With
+    mode == "rules", or when no model is loaded, `classify_by_rules` is
+    used instead.
+
+    Signal arguments: source name, class id, probabilities (or None).
+    Feature and inference times and buffer overruns go to `metrics`.
+    """
+
+    result_ready = pyqtSignal(str, int, object)
+
+    def __init__(
+        self,
+        model: Any,
+        window_samples: int,
+        fs: float = DEFAULT_FS,
+        interval: float = CLASSIFY_INTERVAL,
+        metrics: Optional[Metrics] = None,
+    ) -> None:
+        super().__init__()
+        self.model = model
+        self.mode = "model" if model is not None else "rules"
+        self._window_samples = window_samples
+        self._fs = fs
+        self._interval = interval
+        # name -> (buffer, incremental features or None, last consumed
+        # write count, window scratch array)
+        self._sources: Dict[str, List[Any]] = {}
+        self._window = np.zeros(window_samples, dtype=float)
+        self._stop_event = threading.Event()
+        self._thread: Optional[threading.Thread] = None
+
+        metrics = metrics if metrics is not None else Metrics()
+        self._feature_time = metrics.histogram(
+            "feature_seconds", "Feature extraction time per classification tick"
+        )
+        self._inference_time = metrics.histogram(
+            "inference_seconds", "Classifier time per classification tick"
+        )
+        self._overruns = metrics.counter(
+            "buffer_overruns", "Times the producer lapped the classifier's read position"
+        )
+
+    def add_source(self, name: str, buffer: RingBuffer) -> None:
+        """Register a buffer; call before `start`."""
+        if buffer.channels is None:
+            feats = IncrementalFeatures(self._window_samples, self._fs)
+            self._sources[name] = [buffer, feats, 0, self._window]
+        else:
+            window = np.zeros((buffer.channels, self._window_samples), dtype=float)
+            self._sources[name] = [buffer, None, 0, window]
+
+    def consumed(self, name: str) -> int:
+        """Write count of `name`'s buffer up to which samples were read."""
+        return int(self._sources[name][2])
+
+    def start(self) -> None:
+        self._stop_event.clear()
+        self._thread = threading.Thread(target=self._run, daemon=True)
+        self._thread.start()
+
+    def stop(self) -> None:
+        self._stop_event.set()
+        if self._thread is not None:
+            self._thread.join(timeout=2.0)
+            self._thread = None
+
+    def _run(self) -> None:
+        while not self._stop_event.wait(self._interval):
+            try:
+                self._tick()
+            except Exception as exc:  # noqa: BLE001
+                print(f"[ERROR] Classification failed: {exc}", file=sys.stderr)
+
+    def _catch_up(self, entry: List[Any]) -> bool:
+        """Feed new samples into a source's window; True if it is full."""
+        buffer, feats, consumed, _ = entry
+        if feats is None:
+            return len(buffer) >= self._window_samples
+        written = buffer.written
+        new = written - consumed
+        if written < consumed or new > buffer.capacity:
+            # Buffer was cleared or lapped us: restart from what it holds
+            if written >= consumed:
+                self._overruns.add()
+            feats.reset()
+            new = min(written, buffer.capacity)
+        elif new == 0:
+            return feats.ready
+        for part in buffer.views(new, written):
+            feats.push(part)
+        entry[2] = written
+        return feats.ready
+
+    def _tick(self) -> None:
+        due = [name for name, entry in self._sources.items() if self._catch_up(entry)]
+        if not due:
+            return
+
+        if self.mode == "model" and self.model is not None:
+            with self._feature_time.time():
+                X = np.stack([self._features(self._sources[name]) for name in due])
+            with self._inference_time.time():
+                proba = np.asarray(self.model.predict_proba(X))
+            classes = np.asarray(self.model.classes_)
+            for name, p in zip(due, proba):
+                self.result_ready.emit(name, int(classes[int(np.argmax(p))]), p)
+            return
+
+        for name in due:
+            buffer, _, _, window = self._sources[name]
+            n = buffer.copy_latest(window)
+            if n == self._window_samples:
+                # Rules are defined on a single trace: use the first channel
+                trace = window if window.ndim == 1 else window[0]
+                with self._inference_time.time():
+                    cls = classify_by_rules(trace)
+                self.result_ready.emit(name, cls, None)
+
+    @staticmethod
+    def _features(entry: List[Any]) -> np.ndarray:
+        buffer, feats, _, window = entry
+        if feats is not None:
+            return feats.features()
+        buffer.copy_latest(window)
+        return extract_features_multichannel(window)
+
+
 class MplCanvas(FigureCanvas):
+    """
+    Two-axes canvas with partial redraw for the live trace.
+
+    Artists registered with `add_animated` are left out of normal draws.
+    After every full draw the rendered figure (axes, history panel,
+    labels) is cached, and `blit_animated` restores that background,
+    draws just the animated artists and blits the live axes. Anything
+    that changes the static parts must go through a full `draw_idle`,
+    which refreshes the cache.
+    """
+
     def __init__(self, parent: Optional[QWidget] = None) -> None:
         fig = Figure(figsize=(8, 6))
         # Top axis: live run, Bottom axis: history runs
@@ -197,6 +535,36 @@ class MplCanvas(FigureCanvas):
         super().__init__(fig)
         self.setParent(parent)
 
+        self._background: Any = None
+        self._animated: List[Any] = []
+        self.mpl_connect("draw_event", self._on_draw)
+
+    def add_animated(self, artist: Any) -> None:
+        artist.set_animated(True)
+        self._animated.append(artist)
+
+    def _on_draw(self, _event: Any) -> None:
+        self._background = self.copy_from_bbox(self.figure.bbox)
+        self._draw_animated()
+
+    def _draw_animated(self) -> None:
+        for artist in self._animated:
+            self.figure.draw_artist(artist)
+
+    def blit_animated(self) -> None:
+        """Redraw only the animated artists over the cached background."""
+        if self._background is None:
+            # Nothing cached yet (first frame or after a resize)
+            self.draw_idle()
+            return
+        self.restore_region(self._background)
+        self._draw_animated()
+        self.blit(self.ax_live.bbox)
+
+    def resizeEvent(self, event: Any) -> None:  # type: ignore[override]
+        self._background = None
+        super().resizeEvent(event)
+
 
 class HomeWindow(QMainWindow):
     """
@@ -353,16 +721,41 @@ class MainWindow(QMainWindow):
         self.setWindowTitle("EEG GUI Viewer")
         self.resize(900, 600)
 
-        # Data buffer
-        self.buffer: Deque[float] = deque(maxlen=SAMPLES_TO_SHOW)
+        # Data buffer (SerialReader produces, update_plot consumes)
+        self.buffer = RingBuffer(
+            BUFFER_CAPACITY, channels=CHANNELS if CHANNELS > 1 else None
+        )
+        self._thread_buffer = self.buffer
         self.stop_event: Optional[threading.Event] = None
-        self.reader: Optional[SerialReader] = None
-        # (label, line2d) for each loaded history CSV
-        self.history_entries: List[Tuple[str, Any]] = []
+        # SerialReader, or ReplayReader when replaying a recording (or
+        # the ProcessPipeline standing in for both with MULTIPROCESS)
+        self.reader: Optional[Any] = None
+        self.classifier: Optional[ClassificationWorker] = None
+        self.pipeline: Optional[ProcessPipeline] = None
+        self.recording_path: str = ""
+        # (label, line2d, min/max pyramid) for each loaded history recording
+        self.history_entries: List[Tuple[str, Any, MinMaxPyramid]] = []
+
+        # Pipeline instrumentation shared by reader, classifier and plot
+        self.metrics = Metrics()
+        self._frame_time = self.metrics.histogram("plot_frame_seconds", "update_plot time")
+        self.metrics.gauge(
+            "buffer_fill", lambda: len(self.buffer) / self.buffer.capacity, "Ring buffer fill"
+        )
+        self.metrics.gauge(
+            "recorder_lag_samples",
+            lambda: self.reader.recorder.lag_samples,
+            "Samples submitted but not yet written to the log",
+        )
+        self.metrics.gauge(
+            "recorder_dropped_samples",
+            lambda: self.reader.recorder.dropped_samples,
+            "Samples the log writer had to drop",
+        )
 
         # ML classifier
         self.model: Any = None
-        self.window_samples: int = int(WINDOW_SECONDS * DEFAULT_FS)
+        self.window_samples: int = int(WINDOW_SECONDS * DEVICE_PROFILE.fs)
         self._load_model_if_available()
 
         # Y-scale control flags
@@ -374,9 +767,15 @@ class MainWindow(QMainWindow):
 
         # Timer for updating plot
         self.timer = QTimer(self)
-        self.timer.setInterval(50)  # ms
+        self.timer.setInterval(PLOT_INTERVAL_MS)
         self.timer.timeout.connect(self.update_plot)
 
+        # Slower timer for the stats panel
+        self.stats_timer = QTimer(self)
+        self.stats_timer.setInterval(STATS_INTERVAL_MS)
+        self.stats_timer.timeout.connect(self._update_stats)
+        self.stats_timer.start()
+
     def _init_ui(self) -> None:
         central = QWidget()
         self.setCentralWidget(central)
@@ -457,13 +856,26 @@ class MainWindow(QMainWindow):
         )
         content_layout.addWidget(self.history_list)
 
+        # Pipeline stats panel (see _update_stats)
+        self.stats_label = QLabel("")
+        self.stats_label.setStyleSheet("color: #52606d; font-family: monospace;")
+        content_layout.addWidget(self.stats_label)
+
         layout.addWidget(content_frame)
 
         self.x = np.arange(SAMPLES_TO_SHOW)
-        self.y = np.zeros(SAMPLES_TO_SHOW)
-        (self.line_live,) = self.canvas.ax_live.plot(
-            self.x, self.y, label="Live Voltage", lw=1.0
-        )
+        # One row per channel when multi-channel, matching the ring layout
+        self.y = np.zeros(SAMPLES_TO_SHOW if CHANNELS == 1 else (CHANNELS, SAMPLES_TO_SHOW))
+        rows = [self.y] if CHANNELS == 1 else list(self.y)
+        self.lines_live: List[Any] = []
+        for c, row in enumerate(rows):
+            label = "Live Voltage" if CHANNELS == 1 else f"Ch {c}"
+            (line,) = self.canvas.ax_live.plot(self.x, row, label=label, lw=1.0)
+            # Only the live lines are redrawn each frame (see MplCanvas)
+            self.canvas.add_animated(line)
+            self.lines_live.append(line)
+        self._decimated_bins = 0
+        self._y_decimated = np.zeros(0)
 
         # Configure live axis
         self.canvas.ax_live.set_xlabel("Sample")
@@ -481,6 +893,8 @@ class MainWindow(QMainWindow):
         # Default X scale for history: 0, 100, 200
         self.canvas.ax_history.set_xlim(0, 200)
         self.canvas.ax_history.set_xticks([0, 100, 200])
+        # Re-query the level-of-detail pyramids whenever the view changes
+        self.canvas.ax_history.callbacks.connect("xlim_changed", self._on_history_xlim)
 
         # Controls row
         controls = QHBoxLayout()
@@ -519,13 +933,18 @@ class MainWindow(QMainWindow):
         self.btn_start.clicked.connect(self.start_acquisition)
         controls.addWidget(self.btn_start)
 
+        self.btn_replay = QPushButton("Replay")
+        style_button(self.btn_replay)
+        self.btn_replay.clicked.connect(self.start_replay)
+        controls.addWidget(self.btn_replay)
+
         self.btn_stop = QPushButton("Stop")
         style_button(self.btn_stop)
         self.btn_stop.clicked.connect(self.stop_acquisition)
         self.btn_stop.setEnabled(False)
         controls.addWidget(self.btn_stop)
 
-        self.btn_load = QPushButton("Load History CSV")
+        self.btn_load = QPushButton("Load History")
         style_button(self.btn_load)
         self.btn_load.clicked.connect(self.load_history)
         controls.addWidget(self.btn_load)
@@ -552,6 +971,15 @@ class MainWindow(QMainWindow):
         self.chk_history_autoscale.setStyleSheet("color: #52606d;")
         controls.addWidget(self.chk_history_autoscale)
 
+        # Classifier selection: trained model (if loaded) or rule-based fallback
+        self.cmb_classifier = QComboBox()
+        self.cmb_classifier.addItem("Rules", "rules")
+        if self.model is not None:
+            self.cmb_classifier.addItem("Model", "model")
+            self.cmb_classifier.setCurrentIndex(1)
+        self.cmb_classifier.currentIndexChanged.connect(self._on_classifier_changed)
+        controls.addWidget(self.cmb_classifier)
+
         controls.addStretch(1)
 
         # Status + mental-state labels grouped on the right
@@ -576,7 +1004,24 @@ class MainWindow(QMainWindow):
         layout.addLayout(controls)
 
     def _load_model_if_available(self) -> None:
-        """Load trained EEG mental-state model if the file exists."""
+        """
+        Load trained EEG mental-state model if the file exists.
+
+        The flattened forest exported by train_classifier.py is preferred:
+        it has the same predict_proba interface without sklearn's
+        per-call overhead. The pickled sklearn model is the fallback.
+        """
+        if os.path.exists(FOREST_PATH):
+            try:
+                self.model = FlatForest.load(FOREST_PATH)
+                print(f"[INFO] Loaded flattened ML model from {FOREST_PATH}")
+                if hasattr(self, "status_label"):
+                    self.status_label.setText("Model loaded")
+                return
+            except Exception as exc:  # noqa: BLE001
+                print(f"[ERROR] Could not load model {FOREST_PATH}: {exc}", file=sys.stderr)
+                self.model = None
+
         if os.path.exists(MODEL_PATH):
             try:
                 self.model = joblib.load(MODEL_PATH)
@@ -595,104 +1040,274 @@ class MainWindow(QMainWindow):
 
         os.makedirs(DATA_DIR, exist_ok=True)
         ts = datetime.now().strftime("%Y%m%d_%H%M%S")
-        csv_path = os.path.join(DATA_DIR, f"eeg_{ts}.csv")
+        ext = BINARY_EXT if RECORDING_FORMAT == "binary" else ".csv"
+        record_path = os.path.join(DATA_DIR, f"eeg_{ts}{ext}")
+        self.recording_path = record_path
+
+        if MULTIPROCESS:
+            self._start_pipeline(
+                "serial",
+                f"Recording... {record_path}",
+                port=SERIAL_PORT,
+                baud_rate=BAUD_RATE,
+                record_path=record_path,
+                profile=DEVICE_PROFILE,
+            )
+            return
 
         self.stop_event = threading.Event()
-        self.reader = SerialReader(
+        reader = SerialReader(
             port=SERIAL_PORT,
             baud_rate=BAUD_RATE,
             buffer=self.buffer,
             stop_event=self.stop_event,
-            csv_path=csv_path,
+            record_path=record_path,
+            metrics=self.metrics,
+        )
+        self._start_reader(reader, f"Recording... {record_path}")
+
+    def start_replay(self) -> None:
+        """Stream a recorded session through the live pipeline (no device)."""
+        if self.reader is not None:
+            return
+
+        path, _ = QFileDialog.getOpenFileName(
+            self,
+            "Replay EEG Recording",
+            DATA_DIR,
+            f"EEG Recordings (*{BINARY_EXT} *.csv);;All Files (*)",
+        )
+        if not path:
+            return
+
+        self.recording_path = ""
+        status = f"Replaying... {os.path.basename(path)}"
+        if MULTIPROCESS:
+            self._start_pipeline(
+                "replay", status, path=path, speed=REPLAY_SPEED, live_filter=LIVE_FILTER
+            )
+            return
+
+        self.buffer.clear()
+        self.stop_event = threading.Event()
+        reader = ReplayReader(
+            path,
+            self.buffer,
+            self.stop_event,
+            speed=REPLAY_SPEED,
+            live_filter=LIVE_FILTER,
+            metrics=self.metrics,
         )
+        self._start_reader(reader, status)
+
+    def _start_reader(self, reader: Any, status: str) -> None:
+        self.reader = reader
         self.reader.start()
 
+        # Classification runs on its own thread and reports back via signal
+        self.classifier = ClassificationWorker(
+            self.model, self.window_samples, DEVICE_PROFILE.fs, metrics=self.metrics
+        )
+        self.classifier.mode = self.cmb_classifier.currentData()
+        self.classifier.add_source("live", self.buffer)
+        self.classifier.result_ready.connect(self._on_state)
+        self.classifier.start()
+        self._set_running(status)
+
+    def _start_pipeline(self, source: str, status: str, **reader_kwargs: Any) -> None:
+        """Acquire and classify in child processes; this one only plots."""
+        self.pipeline = ProcessPipeline(
+            BUFFER_CAPACITY,
+            CHANNELS if CHANNELS > 1 else None,
+            self.model,
+            self.window_samples,
+            DEVICE_PROFILE.fs,
+            mode=self.cmb_classifier.currentData(),
+        )
+        self.pipeline.start(source, **reader_kwargs)
+        self.reader = self.pipeline
+        self.buffer = self.pipeline.buffer
+        self.metrics.gauge(
+            "classifier_lag_samples",
+            lambda: self.pipeline.consumer_lag,
+            "Samples published but not yet read by the inference process",
+        )
+        self._set_running(status)
+
+    def _set_running(self, status: str) -> None:
         self.btn_start.setEnabled(False)
+        self.btn_replay.setEnabled(False)
         self.btn_stop.setEnabled(True)
-        self.status_label.setText(f"Recording... {csv_path}")
+        self.status_label.setText(status)
 
         self.timer.start()
 
     def stop_acquisition(self) -> None:
-        if self.reader is None or self.stop_event is None:
-            return
+        if self.pipeline is not None:
+            self.pipeline.stop()
+            self.pipeline = None
+            self.reader = None
+            # The shared block is gone; plot from the (empty) local ring
+            self.buffer = self._thread_buffer
+        else:
+            if self.reader is None or self.stop_event is None:
+                return
 
-        self.stop_event.set()
-        self.reader.join(timeout=2.0)
-        self.reader = None
-        self.stop_event = None
+            if self.classifier is not None:
+                self.classifier.stop()
+                self.classifier = None
+
+            self.stop_event.set()
+            self.reader.join(timeout=2.0)
+            self.reader = None
+            self.stop_event = None
 
         self.btn_start.setEnabled(True)
+        self.btn_replay.setEnabled(True)
         self.btn_stop.setEnabled(False)
         self.status_label.setText("Stopped")
 
         self.timer.stop()
 
     def update_plot(self) -> None:
-        if self.buffer:
-            data = np.array(list(self.buffer), dtype=float)
-
-            if data.size < SAMPLES_TO_SHOW:
-                if data.size == 0:
-                    padded = np.zeros(SAMPLES_TO_SHOW)
-                else:
-                    pad_value = data[0]
-                    pad_len = SAMPLES_TO_SHOW - data.size
-                    padded = np.concatenate(
-                        [np.full(pad_len, pad_value, dtype=float), data]
-                    )
+        if self.pipeline is not None:
+            for source, cls, proba in self.pipeline.poll(self.metrics):
+                self._on_state(source, cls, proba)
+        if not self.buffer:
+            return
+        with self._frame_time.time():
+            # Copy the newest samples straight into the plot's array; pad the
+            # left with the oldest sample until the buffer has filled up.
+            padded = self.y
+            n = self.buffer.copy_latest(padded)
+            if n < SAMPLES_TO_SHOW:
+                pad = SAMPLES_TO_SHOW - n
+                padded[..., :pad] = padded[..., pad : pad + 1]
+
+            self._set_live_data(padded)
+
+            # Full redraw only when the y-limits step; otherwise blit the line
+            limits_changed = self.live_autoscale and self._update_live_ylim(
+                padded.min(), padded.max()
+            )
+            self._update_recorder_status()
+            if limits_changed:
+                self.canvas.draw_idle()
             else:
-                padded = data[-SAMPLES_TO_SHOW:]
-
-            self.line_live.set_ydata(padded)
-
-            y_min, y_max = padded.min(), padded.max()
-            if y_min == y_max:
-                y_min -= 1.0
-                y_max += 1.0
-            margin = 0.1 * (y_max - y_min)
-            # Only auto-adjust Y limits if enabled; otherwise, keep user's zoom
-            if self.live_autoscale:
-                self.canvas.ax_live.set_ylim(y_min - margin, y_max + margin)
-
-            # Classify mental state based on current voltage window
-            if padded.size >= self.window_samples:
-                window = padded[-self.window_samples :]
-                window_arr = np.asarray(window, dtype=float)
-                mean_v = float(np.mean(window_arr))
-                peak_v = float(np.max(window_arr))
-                frac_above_17 = float(np.mean(window_arr > 1.7))
-                frac_above_19 = float(np.mean(window_arr > 1.9))
-
-                # Debug: print 5-second statistics to console
-                print(
-                    f"[DEBUG] 5s mean={mean_v:.4f}, peak={peak_v:.4f}, "
-                    f"frac>1.7={frac_above_17:.3f}, frac>1.9={frac_above_19:.3f}"
+                self.canvas.blit_animated()
+
+    def _update_stats(self) -> None:
+        """Refresh the stats panel (and the metrics file, if configured)."""
+        m = self.metrics
+        m.sample_rates()
+        parts = []
+        if "serial_bytes" in m:
+            parts.append(f"serial {m['serial_bytes'].rate / 1024:.1f} kB/s")
+        if "samples_parsed" in m:
+            parts.append(f"{m['samples_parsed'].rate:.0f} samples/s")
+        if "parse_failures" in m:
+            parts.append(f"parse fail {m['parse_failures'].total}")
+        parts.append(f"buffer {100 * m['buffer_fill'].value:.0f}%")
+        if "buffer_overruns" in m:
+            parts.append(f"overruns {m['buffer_overruns'].total}")
+        parts.append(f"log lag {m['recorder_lag_samples'].value:.0f}")
+        for name, label in (
+            ("feature_seconds", "features"),
+            ("inference_seconds", "infer"),
+            ("plot_frame_seconds", "frame"),
+        ):
+            if name in m and m[name].count:
+                hist = m[name]
+                parts.append(
+                    f"{label} p50 {1e3 * hist.quantile(0.5):.2f} / "
+                    f"p99 {1e3 * hist.quantile(0.99):.2f} ms"
                 )
+        self.stats_label.setText(" | ".join(parts))
 
-                # More robust rule-based classification using activity ratio:
-                # - Focused: strong activity, frequent peaks above ~1.9 V
-                # - Relaxed: noticeable activity above 1.7 V, but weaker high peaks
-                # - Sleepy: almost no time spent above 1.7 V
-                if frac_above_19 >= 0.15 or (peak_v >= 2.0 and frac_above_19 >= 0.05):
-                    name = "Focused"
-                    color = CLASS_COLORS.get(1, "blue")
-                elif frac_above_17 >= 0.10:
-                    name = "Relaxed"
-                    color = CLASS_COLORS.get(0, "green")
+        if METRICS_PATH:
+            try:
+                m.write_prometheus(METRICS_PATH)
+            except OSError as exc:
+                print(f"[ERROR] Could not write metrics to {METRICS_PATH}: {exc}", file=sys.stderr)
+
+    def _set_live_data(self, y: np.ndarray) -> None:
+        """Update the live lines, min/max-decimated when samples outnumber pixels."""
+        rows = y.reshape(len(self.lines_live), -1)
+        n = rows.shape[1]
+        n_bins = max(int(self.canvas.ax_live.bbox.width), 1)
+        if n <= 2 * n_bins:
+            for line, row in zip(self.lines_live, rows):
+                if self._decimated_bins:
+                    line.set_data(self.x, row)
                 else:
-                    name = "Sleepy"
-                    color = CLASS_COLORS.get(2, "orange")
+                    line.set_ydata(row)
+            self._decimated_bins = 0
+            return
+
+        if n_bins != self._decimated_bins:
+            self._decimated_bins = n_bins
+            self._y_decimated = np.empty((rows.shape[0], 2 * n_bins), dtype=float)
+            x = decimated_x(n, n_bins)
+            for line in self.lines_live:
+                line.set_xdata(x)
+        for line, row, out in zip(self.lines_live, rows, self._y_decimated):
+            line.set_ydata(minmax_decimate(row, n_bins, out=out))
 
-                self.pred_label.setText(f"State: {name}")
-                self.pred_label.setStyleSheet(f"color: {color}; font-weight: bold;")
+    def _update_live_ylim(self, y_min: float, y_max: float) -> bool:
+        """
+        Move the live y-limits in hysteresis steps; True if they changed.
 
-            self.canvas.draw_idle()
+        Limits are kept while the data stays inside them and still spans at
+        least LIVE_YLIM_SHRINK of the range, and new limits are snapped to a
+        round step so small fluctuations never invalidate the background.
+        """
+        if y_min == y_max:
+            y_min -= 1.0
+            y_max += 1.0
+        lo, hi = self.canvas.ax_live.get_ylim()
+        span = y_max - y_min
+        if lo <= y_min and y_max <= hi and span >= LIVE_YLIM_SHRINK * (hi - lo):
+            return False
+
+        margin = 0.1 * span
+        step = 10.0 ** np.floor(np.log10(span))
+        new_lo = np.floor((y_min - margin) / step) * step
+        new_hi = np.ceil((y_max + margin) / step) * step
+        self.canvas.ax_live.set_ylim(new_lo, new_hi)
+        return True
+
+    def _on_classifier_changed(self, _index: int) -> None:
+        if self.classifier is not None:
+            self.classifier.mode = self.cmb_classifier.currentData()
+        if self.pipeline is not None:
+            self.pipeline.set_mode(self.cmb_classifier.currentData())
+
+    def _on_state(self, _source: str, cls: int, proba: Any) -> None:
+        """Show a classification result posted by the worker thread."""
+        name = CLASS_NAMES.get(cls, str(cls))
+        color = CLASS_COLORS.get(cls, "black")
+        text = f"State: {name}"
+        if proba is not None:
+            text += f" ({100.0 * float(np.max(proba)):.0f}%)"
+        self.pred_label.setText(text)
+        self.pred_label.setStyleSheet(f"color: {color}; font-weight: bold;")
+
+    def _update_recorder_status(self) -> None:
+        """Show how far the CSV writer is behind the acquisition."""
+        recorder = self.reader.recorder if self.reader is not None else None
+        if recorder is None:
+            return
+        lag = recorder.lag_samples
+        text = f"Recording... {self.recording_path}"
+        if lag > recorder.block_size or recorder.dropped_samples:
+            text += f" (log lag {lag}, dropped {recorder.dropped_samples})"
+        if text != self.status_label.text():
+            self.status_label.setText(text)
 
     def _rebuild_history_list(self) -> None:
         """Refresh the list widget showing loaded history signals."""
         self.history_list.clear()
-        for label, _ in self.history_entries:
+        for label, _line, _pyramid in self.history_entries:
             self.history_list.addItem(label)
 
     def remove_selected_history(self) -> None:
@@ -709,7 +1324,7 @@ class MainWindow(QMainWindow):
 
         for row in selected_rows:
             if 0 <= row < len(self.history_entries):
-                _label, line = self.history_entries.pop(row)
+                _label, line, _pyramid = self.history_entries.pop(row)
                 try:
                     line.remove()
                 except ValueError:
@@ -722,57 +1337,63 @@ class MainWindow(QMainWindow):
             self.canvas.ax_history.relim()
             self.canvas.ax_history.autoscale_view()
         else:
-            self.canvas.ax_history.cla()
-            self.canvas.ax_history.set_xlabel("Sample")
-            self.canvas.ax_history.set_ylabel("Voltage (V)")
-            self.canvas.ax_history.set_title("History Runs (Loaded CSVs)")
-            self.canvas.ax_history.grid(True)
+            # Reset by hand: cla() would also drop the xlim_changed callback
+            legend = self.canvas.ax_history.get_legend()
+            if legend is not None:
+                legend.remove()
+            self.canvas.ax_history.set_xlim(0, 200)
+            self.canvas.ax_history.set_xticks([0, 100, 200])
+
+        self.canvas.draw_idle()
+
+    def _history_width_px(self) -> int:
+        return max(int(self.canvas.ax_history.bbox.width), 1)
 
+    def _on_history_xlim(self, ax: Any) -> None:
+        """Swap each history line to the pyramid level for the new x-range."""
+        if not self.history_entries:
+            return
+        x0, x1 = ax.get_xlim()
+        width = self._history_width_px()
+        for _label, line, pyramid in self.history_entries:
+            line.set_data(*pyramid.query(x0, x1, width))
         self.canvas.draw_idle()
 
     def load_history(self) -> None:
         path, _ = QFileDialog.getOpenFileName(
             self,
-            "Open EEG CSV",
+            "Open EEG Recording",
             DATA_DIR,
-            "CSV Files (*.csv);;All Files (*)",
+            f"EEG Recordings (*{BINARY_EXT} *.csv);;All Files (*)",
         )
         if not path:
             return
 
-        times: List[float] = []
-        voltages: List[float] = []
         try:
-            with open(path, newline="") as f:
-                reader = csv.DictReader(f)
-                for row in reader:
-                    v_str = row.get("voltage")
-                    if not v_str:
-                        continue
-                    try:
-                        v = float(v_str)
-                    except ValueError:
-                        continue
-                    voltages.append(v)
-                    times.append(len(times))  # simple sample index
-        except OSError as exc:
+            rec = open_recording(path)
+        except (OSError, ValueError) as exc:
             print(f"[ERROR] Could not read history file {path}: {exc}", file=sys.stderr)
             return
 
-        if not voltages:
+        if len(rec) == 0:
             return
 
-        times_arr = np.array(times, dtype=float)
-        volts_arr = np.array(voltages, dtype=float)
+        # Min/max pyramid over the (memory-mapped) voltages; the line only
+        # ever holds the level matching the current view. Multi-channel
+        # recordings show their first channel.
+        volts = rec.voltage if rec.voltage.ndim == 1 else rec.voltage[:, 0]
+        pyramid = MinMaxPyramid(volts)
+        x0, x1 = self.canvas.ax_history.get_xlim()
+        times_arr, volts_arr = pyramid.query(x0, x1, self._history_width_px())
 
-        # Plot this CSV as its own history run in the bottom axis
+        # Plot this recording as its own history run in the bottom axis
         (line_hist,) = self.canvas.ax_history.plot(
             times_arr,
             volts_arr,
             label=os.path.basename(path),
             linestyle="--",
         )
-        self.history_entries.append((os.path.basename(path), line_hist))
+        self.history_entries.append((os.path.basename(path), line_hist, pyramid))
         self._rebuild_history_list()
 
         # Only auto-scale history axis (Y only) if enabled.
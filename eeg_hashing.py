@@ -0,0 +1,24 @@
+#!/usr/bin/env python3
+"""
+Content hashes for cache keys.
+
+Shared by train_classifier.py (feature cache) and batch_process.py
+(skipping unchanged recordings), so the batch workers do not need to
+import the training module and scikit-learn.
+"""
+
+from __future__ import annotations
+
+import hashlib
+
+
+def file_sha256(path: str) -> str:
+    """Hex SHA-256 of a file's contents, read in 1 MiB blocks."""
+    digest = hashlib.sha256()
+    with open(path, "rb") as f:
+        for block in iter(lambda: f.read(1 << 20), b""):
+            digest.update(block)
+    return digest.hexdigest()
+
+
+__all__ = ["file_sha256"]
@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+"""
+Lightweight in-process instrumentation for the acquisition pipeline.
+
+Three metric kinds, each cheap enough for the hot path:
+
+    RateCounter  monotonically increasing count (bytes, samples, errors);
+                 `sample()` turns it into a per-second rate
+    Gauge        a value read on demand from a callable (buffer fill,
+                 writer lag), so the producer pays nothing for it
+    Histogram    durations in fixed log-spaced buckets, with approximate
+                 quantiles; recording is one bisect and two additions
+
+Every metric has exactly one writing thread (the serial reader, the
+classification worker or the GUI thread), so no locks are taken; a
+reader may see a snapshot that is one update stale. `Metrics` groups
+them for the GUI's stats panel and can export Prometheus text format.
+Metrics written in another process (eeg_multiproc) travel as picklable
+`snapshot`s and are folded into the GUI's registry with `merge`.
+"""
+
+from __future__ import annotations
+
+import os
+import time
+from bisect import bisect_left
+from contextlib import contextmanager
+from typing import Any, Callable, Dict, Iterator, List, Optional, Tuple, Union
+
+# Histogram bucket upper bounds: 10 us .. ~10 s, doubling
+_BUCKETS: Tuple[float, ...] = tuple(1e-5 * 2.0**i for i in range(21))
+
+
+class RateCounter:
+    def __init__(self, help_text: str = "") -> None:
+        self.help = help_text
+        self.total = 0
+        self.rate = 0.0
+        self._last_total = 0
+        self._last_time = time.monotonic()
+
+    def add(self, n: int = 1) -> None:
+        self.total += n
+
+    def sample(self, now: Optional[float] = None) -> float:
+        """Update and return the rate since the previous sample."""
+        now = time.monotonic() if now is None else now
+        dt = now - self._last_time
+        if dt > 0:
+            total = self.total
+            self.rate = (total - self._last_total) / dt
+            self._last_total = total
+            self._last_time = now
+        return self.rate
+
+
+class Gauge:
+    def __init__(self, read: Callable[[], float], help_text: str = "") -> None:
+        self.help = help_text
+        self._read = read
+
+    @property
+    def value(self) -> float:
+        try:
+            return float(self._read())
+        except Exception:  # noqa: BLE001 - source went away (e.g. reader stopped)
+            return 0.0
+
+
+class Histogram:
+    def __init__(self, help_text: str = "") -> None:
+        self.help = help_text
+        self.counts: List[int] = [0] * (len(_BUCKETS) + 1)
+        self.count = 0
+        self.sum = 0.0
+        self.max = 0.0
+
+    def record(self, seconds: float) -> None:
+        self.counts[bisect_left(_BUCKETS, seconds)] += 1
+        self.count += 1
+        self.sum += seconds
+        if seconds > self.max:
+            self.max = seconds
+
+    @contextmanager
+    def time(self) -> Iterator[None]:
+        t0 = time.perf_counter()
+        try:
+            yield
+        finally:
+            self.record(time.perf_counter() - t0)
+
+    @property
+    def mean(self) -> float:
+        return self.sum / self.count if self.count else 0.0
+
+    def quantile(self, q: float) -> float:
+        """Upper bound of the bucket holding the q-th quantile."""
+        if not self.count:
+            return 0.0
+        target = q * self.count
+        seen = 0
+        for i, c in enumerate(self.counts):
+            seen += c
+            if seen >= target and c:
+                return _BUCKETS[i] if i < len(_BUCKETS) else self.max
+        return self.max
+
+
+Metric = Union[RateCounter, Gauge, Histogram]
+Snapshot = Dict[str, Tuple[Any, ...]]
+
+
+class Metrics:
+    """Named registry of pipeline metrics."""
+
+    def __init__(self) -> None:
+        self._metrics: Dict[str, Metric] = {}
+
+    def counter(self, name: str, help_text: str = "") -> RateCounter:
+        return self._get(name, lambda: RateCounter(help_text))  # type: ignore[return-value]
+
+    def histogram(self, name: str, help_text: str = "") -> Histogram:
+        return self._get(name, lambda: Histogram(help_text))  # type: ignore[return-value]
+
+    def gauge(self, name: str, read: Callable[[], float], help_text: str = "") -> Gauge:
+        """Register (or replace) a gauge; sources change between runs."""
+        gauge = Gauge(read, help_text)
+        self._metrics[name] = gauge
+        return gauge
+
+    def _get(self, name: str, make: Callable[[], Metric]) -> Metric:
+        metric = self._metrics.get(name)
+        if metric is None:
+            metric = self._metrics[name] = make()
+        return metric
+
+    def __getitem__(self, name: str) -> Metric:
+        return self._metrics[name]
+
+    def __contains__(self, name: str) -> bool:
+        return name in self._metrics
+
+    def snapshot(self) -> Snapshot:
+        """Picklable copy of the counters and histograms (gauges stay local)."""
+        snap: Snapshot = {}
+        for name, metric in self._metrics.items():
+            if isinstance(metric, RateCounter):
+                snap[name] = ("counter", metric.help, metric.total)
+            elif isinstance(metric, Histogram):
+                snap[name] = (
+                    "histogram",
+                    metric.help,
+                    list(metric.counts),
+                    metric.count,
+                    metric.sum,
+                    metric.max,
+                )
+        return snap
+
+    def merge(self, snapshot: Snapshot, previous: Optional[Snapshot] = None) -> None:
+        """
+        Add what changed between two snapshots of another registry.
+
+        Passing the previous snapshot from the same source keeps counters
+        monotonic here even when that source restarts from zero.
+        """
+        previous = previous or {}
+        for name, entry in snapshot.items():
+            prev = previous.get(name)
+            if entry[0] == "counter":
+                self.counter(name, entry[1]).add(entry[2] - (prev[2] if prev else 0))
+                continue
+            hist = self.histogram(name, entry[1])
+            counts, count, total, top = entry[2:]
+            prev_counts = prev[2] if prev else [0] * len(counts)
+            for i, (c, pc) in enumerate(zip(counts, prev_counts)):
+                hist.counts[i] += c - pc
+            hist.count += count - (prev[3] if prev else 0)
+            hist.sum += total - (prev[4] if prev else 0.0)
+            hist.max = max(hist.max, top)
+
+    def sample_rates(self) -> None:
+        now = time.monotonic()
+        for metric in self._metrics.values():
+            if isinstance(metric, RateCounter):
+                metric.sample(now)
+
+    def prometheus_text(self, prefix: str = "eeg_") -> str:
+        lines: List[str] = []
+        for name, metric in sorted(self._metrics.items()):
+            full = prefix + name
+            if metric.help:
+                lines.append(f"# HELP {full} {metric.help}")
+            if isinstance(metric, RateCounter):
+                lines.append(f"# TYPE {full} counter")
+                lines.append(f"{full} {metric.total}")
+            elif isinstance(metric, Gauge):
+                lines.append(f"# TYPE {full} gauge")
+                lines.append(f"{full} {metric.value:g}")
+            else:
+                lines.append(f"# TYPE {full} histogram")
+                cumulative = 0
+                for bound, c in zip(_BUCKETS, metric.counts):
+                    cumulative += c
+                    lines.append(f'{full}_bucket{{le="{bound:g}"}} {cumulative}')
+                lines.append(f'{full}_bucket{{le="+Inf"}} {metric.count}')
+                lines.append(f"{full}_sum {metric.sum:g}")
+                lines.append(f"{full}_count {metric.count}")
+        return "\n".join(lines) + "\n"
+
+    def write_prometheus(self, path: str) -> None:
+        """Write the text exposition atomically (node_exporter textfile style)."""
+        os.makedirs(os.path.dirname(path) or ".", exist_ok=True)
+        tmp = path + ".tmp"
+        with open(tmp, "w", encoding="utf-8") as f:
+            f.write(self.prometheus_text())
+        os.replace(tmp, path)
+
+
+__all__ = ["Metrics", "RateCounter", "Gauge", "Histogram"]
@@ -0,0 +1,323 @@
+#!/usr/bin/env python3
+"""
+Multi-process acquisition pipeline around a shared-memory ring buffer.
+
+In the threaded GUI the serial reader, the classifier and the Qt event
+loop (with matplotlib drawing) share one GIL, so a slow redraw delays
+serial reads. With eeg_gui.MULTIPROCESS set, each stage gets its own
+process and core instead:
+
+    acquisition process   SerialReader / ReplayReader -> SharedRingBuffer
+    inference process     ClassificationWorker reading the same ring
+    GUI process           maps the ring read-only for plotting
+
+`SharedRingBuffer` is an eeg_buffer.RingBuffer whose storage and write
+counter live in a `multiprocessing.shared_memory` block, so every
+RingBuffer method works unchanged on either side. The single-producer
+contract carries over: the acquisition process fills slots and then
+publishes them with one aligned 8-byte store of the head counter; the
+inference process publishes how far it has read in the tail slot.
+Readers snapshot the head and check `intact` afterwards, exactly as
+with threads. (Ordering relies on the platform keeping stores in order,
+as x86-64 does; shared_memory offers no explicit fences.)
+
+Results, metrics snapshots and recorder status come back to the GUI on
+one multiprocessing queue, drained by `ProcessPipeline.poll`.
+"""
+
+from __future__ import annotations
+
+import multiprocessing as mp
+import queue
+import sys
+import time
+from dataclasses import dataclass
+from multiprocessing import shared_memory
+from typing import Any, Dict, List, Optional, Tuple
+
+import numpy as np
+
+from eeg_buffer import RingBuffer
+from eeg_features import DEFAULT_FS
+from eeg_metrics import Metrics, Snapshot
+
+
+# Header of int64 slots before the samples; head and tail sit on
+# separate cache lines so producer and consumer never share one
+_HEADER_BYTES = 128
+_HEAD = 0  # samples published (RingBuffer.written)
+_TAIL = 8  # samples consumed by the inference process
+PUBLISH_INTERVAL = 0.25  # seconds between metrics / tail updates from children
+MODES = ("model", "rules")  # ClassificationWorker.mode, shared as an index
+
+# (shared memory name, capacity, dtype string, channels)
+BufferSpec = Tuple[str, int, str, Optional[int]]
+
+
+def _attach(name: str) -> shared_memory.SharedMemory:
+    if sys.version_info >= (3, 13):
+        return shared_memory.SharedMemory(name=name, track=False)
+    # Spawned children share the creator's resource tracker, so the extra
+    # registration is harmless: the creator's unlink removes the entry
+    return shared_memory.SharedMemory(name=name)
+
+
+class SharedRingBuffer(RingBuffer):
+    """
+    RingBuffer backed by shared memory.
+
+    Created without `name` it allocates a new block and owns it (`close`
+    unlinks it); `attach(spec)` maps an existing one in another process.
+    """
+
+    def __init__(
+        self,
+        capacity: int,
+        dtype: Any = np.float64,
+        channels: Optional[int] = None,
+        name: Optional[str] = None,
+    ) -> None:
+        if capacity <= 0:
+            raise ValueError("capacity must be positive")
+        self.capacity = int(capacity)
+        self.channels = channels
+        dtype = np.dtype(dtype)
+        shape = (self.capacity,) if channels is None else (int(channels), self.capacity)
+        size = _HEADER_BYTES + int(np.prod(shape)) * dtype.itemsize
+
+        self._owner = name is None
+        if self._owner:
+            self._shm = shared_memory.SharedMemory(create=True, size=size)
+        else:
+            self._shm = _attach(name)
+        self._header = np.ndarray((_HEADER_BYTES // 8,), dtype=np.int64, buffer=self._shm.buf)
+        self._data = np.ndarray(shape, dtype=dtype, buffer=self._shm.buf, offset=_HEADER_BYTES)
+        if self._owner:
+            self._header.fill(0)
+
+    @classmethod
+    def attach(cls, spec: BufferSpec) -> "SharedRingBuffer":
+        name, capacity, dtype, channels = spec
+        return cls(capacity, dtype, channels, name=name)
+
+    @property
+    def spec(self) -> BufferSpec:
+        """Everything another process needs to `attach`."""
+        return (self._shm.name, self.capacity, self._data.dtype.str, self.channels)
+
+    # RingBuffer reads and writes its counter through this attribute
+    @property
+    def _written(self) -> int:  # type: ignore[override]
+        return int(self._header[_HEAD])
+
+    @_written.setter
+    def _written(self, value: int) -> None:
+        self._header[_HEAD] = value
+
+    @property
+    def tail(self) -> int:
+        """Write count up to which the consumer has read (consumer-owned)."""
+        return int(self._header[_TAIL])
+
+    @tail.setter
+    def tail(self, value: int) -> None:
+        self._header[_TAIL] = value
+
+    def close(self) -> None:
+        """Unmap the block; the owner also frees it."""
+        # Views into the block must go before it can be unmapped
+        self._data = np.zeros((0,) * self._data.ndim, dtype=self._data.dtype)
+        self._header = np.zeros(_HEADER_BYTES // 8, dtype=np.int64)
+        self._shm.close()
+        if self._owner:
+            self._shm.unlink()
+
+
+@dataclass
+class RecorderStatus:
+    """What the GUI shows of the log writer running in the acquisition process."""
+
+    lag_samples: int = 0
+    dropped_samples: int = 0
+    block_size: int = 0
+
+
+# ---------------- child processes ----------------
+def _acquisition_main(
+    spec: BufferSpec,
+    stop_event: Any,
+    results: Any,
+    source: str,
+    kwargs: Dict[str, Any],
+) -> None:
+    buffer = SharedRingBuffer.attach(spec)
+    metrics = Metrics()
+    if source == "serial":
+        from eeg_gui import SerialReader
+
+        reader: Any = SerialReader(buffer=buffer, stop_event=stop_event, metrics=metrics, **kwargs)
+    else:
+        from eeg_replay import ReplayReader
+
+        path = kwargs.pop("path")
+        reader = ReplayReader(path, buffer, stop_event, metrics=metrics, **kwargs)
+
+    reader.start()
+    try:
+        while reader.is_alive():
+            reader.join(PUBLISH_INTERVAL)
+            results.put(("metrics", "acquisition", metrics.snapshot()))
+            rec = reader.recorder
+            if rec is not None:
+                results.put(("recorder", rec.lag_samples, rec.dropped_samples, rec.block_size))
+    except KeyboardInterrupt:
+        stop_event.set()
+        reader.join()
+    finally:
+        buffer.close()
+
+
+def _inference_main(
+    spec: BufferSpec,
+    stop_event: Any,
+    results: Any,
+    mode: Any,
+    model: Any,
+    window_samples: int,
+    fs: float,
+) -> None:
+    from PyQt5.QtCore import Qt
+
+    from eeg_gui import ClassificationWorker
+
+    buffer = SharedRingBuffer.attach(spec)
+    metrics = Metrics()
+    worker = ClassificationWorker(model, window_samples, fs, metrics=metrics)
+    worker.mode = MODES[mode.value]
+    worker.add_source("live", buffer)
+    # No Qt event loop here: deliver straight from the worker thread
+    worker.result_ready.connect(
+        lambda name, cls, proba: results.put(("state", name, cls, proba)),
+        Qt.DirectConnection,
+    )
+    worker.start()
+    try:
+        while not stop_event.wait(PUBLISH_INTERVAL):
+            worker.mode = MODES[mode.value]
+            buffer.tail = worker.consumed("live")
+            results.put(("metrics", "inference", metrics.snapshot()))
+    except KeyboardInterrupt:
+        pass
+    finally:
+        worker.stop()
+        buffer.close()
+
+
+# ---------------- GUI side ----------------
+class ProcessPipeline:
+    """
+    Owns the shared ring and the two child processes.
+
+    `buffer` is for reading only (plotting); `poll` must be called
+    regularly from the GUI thread to collect classification results and
+    fold the children's metrics into the GUI's registry. `recorder`
+    mirrors the acquisition process's log writer once it reports, so the
+    object can stand in for a reader in MainWindow.
+    """
+
+    def __init__(
+        self,
+        capacity: int,
+        channels: Optional[int],
+        model: Any,
+        window_samples: int,
+        fs: float = DEFAULT_FS,
+        mode: str = "model",
+    ) -> None:
+        # Spawn, not fork: forking a process with Qt running is unsafe
+        self._ctx = mp.get_context("spawn")
+        self.buffer = SharedRingBuffer(capacity, channels=channels)
+        self._stop_event = self._ctx.Event()
+        self._results = self._ctx.Queue()
+        self._mode = self._ctx.Value("i", MODES.index(mode))
+        self._model = model
+        self._window_samples = window_samples
+        self._fs = fs
+        self._procs: List[Any] = []
+        self._last: Dict[str, Snapshot] = {}
+        self.recorder: Optional[RecorderStatus] = None
+
+    def start(self, source: str, **reader_kwargs: Any) -> None:
+        """Start acquisition from `source` ("serial" or "replay") and inference."""
+        if source not in ("serial", "replay"):
+            raise ValueError(f"Unknown source: {source!r}")
+        spec = self.buffer.spec
+        self._procs = [
+            self._ctx.Process(
+                target=_acquisition_main,
+                args=(spec, self._stop_event, self._results, source, reader_kwargs),
+                name="eeg-acquisition",
+                daemon=True,
+            ),
+            self._ctx.Process(
+                target=_inference_main,
+                args=(
+                    spec,
+                    self._stop_event,
+                    self._results,
+                    self._mode,
+                    self._model,
+                    self._window_samples,
+                    self._fs,
+                ),
+                name="eeg-inference",
+                daemon=True,
+            ),
+        ]
+        for proc in self._procs:
+            proc.start()
+
+    def set_mode(self, mode: str) -> None:
+        self._mode.value = MODES.index(mode)
+
+    @property
+    def consumer_lag(self) -> int:
+        """Samples published but not yet read by the inference process."""
+        return self.buffer.written - self.buffer.tail
+
+    def poll(self, metrics: Optional[Metrics] = None) -> List[Tuple[str, int, Any]]:
+        """Drain the result queue; returns (source, class id, probabilities)."""
+        states = []
+        while True:
+            try:
+                msg = self._results.get_nowait()
+            except queue.Empty:
+                break
+            kind = msg[0]
+            if kind == "state":
+                states.append(msg[1:])
+            elif kind == "metrics":
+                if metrics is not None:
+                    metrics.merge(msg[2], self._last.get(msg[1]))
+                self._last[msg[1]] = msg[2]
+            elif kind == "recorder":
+                self.recorder = RecorderStatus(*msg[1:])
+        return states
+
+    def stop(self, timeout: float = 2.0) -> None:
+        self._stop_event.set()
+        deadline = time.monotonic() + timeout
+        for proc in self._procs:
+            # Keep draining: a child cannot exit while its queued items are unsent
+            while proc.is_alive() and time.monotonic() < deadline:
+                self.poll()
+                proc.join(0.05)
+            if proc.is_alive():
+                print(f"[WARN] {proc.name} did not stop; terminating", file=sys.stderr)
+                proc.terminate()
+                proc.join()
+        self._procs = []
+        self.buffer.close()
+
+
+__all__ = ["SharedRingBuffer", "ProcessPipeline", "RecorderStatus", "MODES"]
@@ -0,0 +1,447 @@
+// Native kernels for the EEG pipeline, built as the `eeg_native` Python
+// extension (pybind11, see requirements.txt):
+//
+//     c++ -O3 -Wall -shared -std=c++17 -fPIC $(python3 -m pybind11 --includes)
+//         eeg_native.cpp -o eeg_native$(python3-config --extension-suffix)
+//
+// The build is optional: eeg_features uses the module when it imports and
+// keeps its NumPy path otherwise.
+//
+//   FeaturePlan  extract_features for windows of one length: time-domain
+//                stats in a fused pass, one mixed-radix real FFT per
+//                window and the SpectralPlan band weights over its bins
+//   ForestEvaluator  FlatForest.predict_proba as a per-tree walk from the
+//                root to its leaf, without NumPy's per-step temporaries
+//
+// Batch calls release the GIL, so extract_features_batch's thread pool
+// runs them on all cores.
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+namespace eeg {
+
+using cplx = std::complex<double>;
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Radix-3 and radix-5 butterfly constants: cos / sin of 2 pi k / p
+const double kSin60 = std::sqrt(3.0) / 2.0;
+const double kCos72 = std::cos(2.0 * kPi / 5.0), kSin72 = std::sin(2.0 * kPi / 5.0);
+const double kCos144 = std::cos(4.0 * kPi / 5.0), kSin144 = std::sin(4.0 * kPi / 5.0);
+
+inline cplx minus_i(const cplx& a) { return cplx(a.imag(), -a.real()); }
+
+// Plain complex product: operator* must also handle inf/NaN operands
+// (C99 Annex G) and compiles to a library call without -ffast-math
+inline cplx mul(const cplx& a, const cplx& b) {
+    return cplx(a.real() * b.real() - a.imag() * b.imag(),
+                a.real() * b.imag() + a.imag() * b.real());
+}
+
+// ---------------- FFT ----------------
+// Complex DFT of one length, planned once: the radix factors (4s first,
+// then primes; 2, 3, 4 and 5 have unrolled butterflies) and a table of
+// the n-th roots of unity. Stateless after
+// construction, so one plan can serve several threads.
+class FftPlan {
+public:
+    explicit FftPlan(int n) : n_(n), roots_(static_cast<std::size_t>(n)) {
+        if (n < 1) throw std::invalid_argument("FFT length must be positive");
+        for (int k = 0; k < n; ++k) {
+            const double a = -2.0 * kPi * k / n;
+            roots_[k] = cplx(std::cos(a), std::sin(a));
+        }
+        int m = n;
+        while (m % 4 == 0) {
+            factors_.push_back(4);
+            m /= 4;
+        }
+        for (int p = 2; m > 1; ++p) {
+            while (m % p == 0) {
+                factors_.push_back(p);
+                m /= p;
+            }
+        }
+        max_radix_ = factors_.empty() ? 1 : *std::max_element(factors_.begin(), factors_.end());
+    }
+
+    int size() const { return n_; }
+    int max_radix() const { return max_radix_; }
+
+    // out[k] = sum_j in[j] exp(-2 pi i j k / n). `scratch` holds at least
+    // max_radix() values; `in` and `out` must not overlap.
+    void forward(const cplx* in, cplx* out, cplx* scratch) const {
+        if (n_ == 1) {
+            out[0] = in[0];
+            return;
+        }
+        pass(in, out, n_, 1, 0, scratch);
+    }
+
+private:
+    // Decimation in time: FFT the p interleaved sub-sequences of `in`
+    // (every stride-th value) into consecutive blocks of `out`, then
+    // combine them with radix-p butterflies.
+    void pass(const cplx* in, cplx* out, int n, int stride, std::size_t f, cplx* t) const {
+        const int p = factors_[f];
+        const int m = n / p;
+        if (m == 1) {
+            for (int r = 0; r < p; ++r) out[r] = in[r * stride];
+        } else {
+            for (int r = 0; r < p; ++r) pass(in + r * stride, out + r * m, m, stride * p, f + 1, t);
+        }
+
+        // X[k + q m] = sum_r w_n^(r k) w_p^(r q) Y_r[k], w_n = w_N^(N / n)
+        const int step = n_ / n;
+        const int root_p = n_ / p;
+        for (int k = 0; k < m; ++k) {
+            t[0] = out[k];
+            for (int r = 1; r < p; ++r) t[r] = mul(out[r * m + k], roots_[r * k * step]);
+            if (p == 2) {
+                out[k] = t[0] + t[1];
+                out[k + m] = t[0] - t[1];
+            } else if (p == 4) {
+                const cplx a = t[0] + t[2], b = t[0] - t[2];
+                const cplx c = t[1] + t[3], d = t[1] - t[3];
+                const cplx d_rot = minus_i(d);
+                out[k] = a + c;
+                out[k + m] = b + d_rot;
+                out[k + 2 * m] = a - c;
+                out[k + 3 * m] = b - d_rot;
+            } else if (p == 3) {
+                const cplx s = t[1] + t[2];
+                const cplx d = minus_i(t[1] - t[2]) * kSin60;
+                const cplx h = t[0] - 0.5 * s;
+                out[k] = t[0] + s;
+                out[k + m] = h + d;
+                out[k + 2 * m] = h - d;
+            } else if (p == 5) {
+                const cplx a1 = t[1] + t[4], b1 = t[1] - t[4];
+                const cplx a2 = t[2] + t[3], b2 = t[2] - t[3];
+                const cplx h1 = t[0] + kCos72 * a1 + kCos144 * a2;
+                const cplx h2 = t[0] + kCos144 * a1 + kCos72 * a2;
+                const cplx d1 = minus_i(kSin72 * b1 + kSin144 * b2);
+                const cplx d2 = minus_i(kSin144 * b1 - kSin72 * b2);
+                out[k] = t[0] + a1 + a2;
+                out[k + m] = h1 + d1;
+                out[k + 2 * m] = h2 + d2;
+                out[k + 3 * m] = h2 - d2;
+                out[k + 4 * m] = h1 - d1;
+            } else {
+                for (int q = 0; q < p; ++q) {
+                    cplx acc = t[0];
+                    int rq = 0;  // r q mod p, stepped instead of divided
+                    for (int r = 1; r < p; ++r) {
+                        rq += q;
+                        if (rq >= p) rq -= p;
+                        acc += mul(t[r], roots_[rq * root_p]);
+                    }
+                    out[k + q * m] = acc;
+                }
+            }
+        }
+    }
+
+    int n_;
+    std::vector<cplx> roots_;
+    std::vector<int> factors_;
+    int max_radix_ = 1;
+};
+
+// Bins 0 .. n/2 of the DFT of a real sequence. Even lengths pack the
+// samples pairwise into a half-length complex FFT, z[j] = x[2j] + i x[2j+1],
+// and untangle its even/odd spectra: X[k] = E[k] + w_n^k O[k].
+class RealFftPlan {
+public:
+    explicit RealFftPlan(int n)
+        : n_(n), fft_(n % 2 == 0 ? n / 2 : n), roots_(static_cast<std::size_t>(n / 2 + 1)) {
+        for (int k = 0; k <= n / 2; ++k) {
+            const double a = -2.0 * kPi * k / n;
+            roots_[k] = cplx(std::cos(a), std::sin(a));
+        }
+    }
+
+    int size() const { return n_; }
+
+    // Buffers for one thread
+    struct Work {
+        explicit Work(const RealFftPlan& plan)
+            : packed(plan.fft_.size()), spec(plan.fft_.size()), scratch(plan.fft_.max_radix()) {}
+        std::vector<cplx> packed, spec, scratch;
+    };
+
+    // out[k] = X[k] for the first `bins` (at most n/2 + 1) bins
+    void forward(const double* x, cplx* out, int bins, Work& w) const {
+        if (n_ % 2 != 0) {
+            for (int j = 0; j < n_; ++j) w.packed[j] = cplx(x[j], 0.0);
+            fft_.forward(w.packed.data(), w.spec.data(), w.scratch.data());
+            std::copy(w.spec.begin(), w.spec.begin() + bins, out);
+            return;
+        }
+        const int h = n_ / 2;
+        for (int j = 0; j < h; ++j) w.packed[j] = cplx(x[2 * j], x[2 * j + 1]);
+        fft_.forward(w.packed.data(), w.spec.data(), w.scratch.data());
+        for (int k = 0; k < bins; ++k) {
+            const cplx zk = w.spec[k == h ? 0 : k];
+            const cplx zc = std::conj(w.spec[k == 0 ? 0 : h - k]);
+            const cplx even = 0.5 * (zk + zc);
+            const cplx odd = minus_i(0.5 * (zk - zc));
+            out[k] = even + mul(roots_[k], odd);
+        }
+    }
+
+private:
+    int n_;
+    FftPlan fft_;
+    std::vector<cplx> roots_;
+};
+
+// ---------------- features ----------------
+// (start, stop, weights): band power = sum of |X_k|^2 weights[k - start]
+// over bins start <= k < stop, as SpectralPlan.slices
+using BandSlice = std::tuple<int, int, std::vector<double>>;
+
+class FeaturePlan {
+public:
+    static constexpr int kStats = 5;  // mean, std, min, max, max - min
+
+    FeaturePlan(int n, std::vector<BandSlice> bands) : rfft_(n), bands_(std::move(bands)) {
+        for (const auto& band : bands_) {
+            const int start = std::get<0>(band), stop = std::get<1>(band);
+            if (start < 0 || stop < start || stop > n / 2 + 1
+                || std::get<2>(band).size() != static_cast<std::size_t>(stop - start)) {
+                throw std::invalid_argument("band slices do not fit an n-sample rfft");
+            }
+            bins_ = std::max(bins_, stop);
+        }
+    }
+
+    int n() const { return rfft_.size(); }
+    int n_features() const { return kStats + static_cast<int>(bands_.size()); }
+
+    // Feature vectors of `rows` consecutive n-sample windows at x
+    void run(const double* x, std::ptrdiff_t rows, double* out) const {
+        const int n = rfft_.size();
+        RealFftPlan::Work work(rfft_);
+        std::vector<double> centred(n);
+        std::vector<cplx> spec(bins_);
+        for (std::ptrdiff_t i = 0; i < rows; ++i) {
+            window(x + i * n, out + i * n_features(), centred.data(), spec.data(), work);
+        }
+    }
+
+private:
+    void window(const double* x, double* out, double* centred, cplx* spec,
+                RealFftPlan::Work& work) const {
+        const int n = rfft_.size();
+        double sum = 0.0, lo = x[0], hi = x[0];
+        for (int i = 0; i < n; ++i) {
+            sum += x[i];
+            lo = std::min(lo, x[i]);
+            hi = std::max(hi, x[i]);
+        }
+        const double mean = sum / n;
+
+        // The centred signal feeds both the std and the spectrum
+        double sumsq = 0.0;
+        for (int i = 0; i < n; ++i) {
+            const double d = x[i] - mean;
+            sumsq += d * d;
+            centred[i] = d;
+        }
+        out[0] = mean;
+        out[1] = std::sqrt(sumsq / n);
+        out[2] = lo;
+        out[3] = hi;
+        out[4] = hi - lo;
+
+        // Only the bins up to the highest band edge are untangled
+        rfft_.forward(centred, spec, bins_, work);
+        for (std::size_t b = 0; b < bands_.size(); ++b) {
+            const int start = std::get<0>(bands_[b]), stop = std::get<1>(bands_[b]);
+            const double* w = std::get<2>(bands_[b]).data();
+            double acc = 0.0;
+            for (int k = start; k < stop; ++k) acc += std::norm(spec[k]) * w[k - start];
+            out[kStats + b] = acc;
+        }
+    }
+
+    RealFftPlan rfft_;
+    std::vector<BandSlice> bands_;
+    int bins_ = 0;  // bins any band reads
+};
+
+// ---------------- forest ----------------
+// FlatForest node arrays (see eeg_forest.py): leaves point back to
+// themselves, internal nodes go left when x[feature] <= threshold
+class ForestEvaluator {
+public:
+    ForestEvaluator(const std::vector<std::int32_t>& feature, const std::vector<double>& threshold,
+                    const std::vector<std::int32_t>& left, const std::vector<std::int32_t>& right,
+                    std::vector<double> value, int n_classes, std::vector<std::int32_t> roots,
+                    int max_depth)
+        : value_(std::move(value)), roots_(std::move(roots)), n_classes_(n_classes),
+          max_depth_(max_depth) {
+        const std::size_t nodes = feature.size();
+        if (n_classes_ <= 0 || threshold.size() != nodes || left.size() != nodes
+            || right.size() != nodes || value_.size() != nodes * n_classes_) {
+            throw std::invalid_argument("forest arrays disagree on the node count");
+        }
+        const auto in_range = [nodes](std::int32_t i) {
+            return i >= 0 && static_cast<std::size_t>(i) < nodes;
+        };
+        nodes_.resize(nodes);
+        for (std::size_t i = 0; i < nodes; ++i) {
+            if (!in_range(left[i]) || !in_range(right[i]) || feature[i] < 0) {
+                throw std::invalid_argument("forest child or feature index out of range");
+            }
+            nodes_[i] = {threshold[i], feature[i], left[i], right[i]};
+            n_features_ = std::max(n_features_, feature[i] + 1);
+        }
+        if (!std::all_of(roots_.begin(), roots_.end(), in_range)) {
+            throw std::invalid_argument("forest root index out of range");
+        }
+    }
+
+    int n_classes() const { return n_classes_; }
+    int n_features() const { return n_features_; }
+
+    // out[i] = leaf distributions of row x[i] averaged over the trees;
+    // rows are float32 like sklearn's inputs, compared in double
+    void predict_proba(const float* x, std::ptrdiff_t rows, int cols, double* out) const {
+        const double scale = roots_.empty() ? 0.0 : 1.0 / roots_.size();
+        for (std::ptrdiff_t r = 0; r < rows; ++r) {
+            const float* row = x + r * cols;
+            double* acc = out + r * n_classes_;
+            std::fill(acc, acc + n_classes_, 0.0);
+            // kLanes trees walk in lockstep so their cache misses overlap
+            for (std::size_t t = 0; t < roots_.size(); t += kLanes) {
+                const int lanes = static_cast<int>(std::min(kLanes, roots_.size() - t));
+                std::int32_t at[kLanes];
+                std::copy(roots_.begin() + t, roots_.begin() + t + lanes, at);
+                // Bounded like the NumPy path, which takes max_depth steps
+                for (int step = 0; step < max_depth_; ++step) {
+                    bool moved = false;
+                    for (int k = 0; k < lanes; ++k) {
+                        const Node& node = nodes_[at[k]];
+                        const std::int32_t next =
+                            static_cast<double>(row[node.feature]) <= node.threshold ? node.left
+                                                                                     : node.right;
+                        moved |= next != at[k];
+                        at[k] = next;
+                    }
+                    if (!moved) break;
+                }
+                for (int k = 0; k < lanes; ++k) {
+                    const double* leaf = &value_[static_cast<std::size_t>(at[k]) * n_classes_];
+                    for (int c = 0; c < n_classes_; ++c) acc[c] += leaf[c];
+                }
+            }
+            for (int c = 0; c < n_classes_; ++c) acc[c] *= scale;
+        }
+    }
+
+private:
+    static constexpr std::size_t kLanes = 16;
+
+    // One step reads one node: 24 bytes instead of four scattered arrays
+    struct Node {
+        double threshold;
+        std::int32_t feature, left, right;
+    };
+
+    std::vector<Node> nodes_;
+    std::vector<double> value_;  // (n_nodes, n_classes), row-major
+    std::vector<std::int32_t> roots_;
+    int n_classes_;
+    int max_depth_;
+    int n_features_ = 0;  // highest feature index tested, plus one
+};
+
+}  // namespace eeg
+
+// ---------------- Python bindings ----------------
+namespace py = pybind11;
+
+using InArray = py::array_t<double, py::array::c_style | py::array::forcecast>;
+using OutArray = py::array_t<double, py::array::c_style>;
+using FloatArray = py::array_t<float, py::array::c_style | py::array::forcecast>;
+using IndexArray = py::array_t<std::int32_t, py::array::c_style | py::array::forcecast>;
+
+template <typename Array>
+static std::vector<typename Array::value_type> to_vector(const Array& a) {
+    return {a.data(), a.data() + a.size()};
+}
+
+PYBIND11_MODULE(eeg_native, m) {
+    m.doc() = "Native feature and forest kernels for the EEG pipeline (see eeg_native.cpp).";
+
+    py::class_<eeg::FeaturePlan>(m, "FeaturePlan")
+        .def(py::init<int, std::vector<eeg::BandSlice>>(), py::arg("n"), py::arg("bands"))
+        .def_property_readonly("n", &eeg::FeaturePlan::n)
+        .def_property_readonly("n_features", &eeg::FeaturePlan::n_features)
+        .def(
+            "features",
+            [](const eeg::FeaturePlan& plan, InArray X, OutArray out) {
+                if (X.ndim() != 2 || X.shape(1) != plan.n()) {
+                    throw std::invalid_argument("X must have shape (rows, n)");
+                }
+                if (out.ndim() != 2 || out.shape(0) != X.shape(0)
+                    || out.shape(1) != plan.n_features()) {
+                    throw std::invalid_argument("out must have shape (rows, n_features)");
+                }
+                const double* x = X.data();
+                double* o = out.mutable_data();
+                const std::ptrdiff_t rows = X.shape(0);
+                py::gil_scoped_release release;
+                plan.run(x, rows, o);
+            },
+            py::arg("X"),
+            py::arg("out").noconvert(),
+            "Fill out[i] with the feature vector of window X[i].");
+
+    py::class_<eeg::ForestEvaluator>(m, "ForestEvaluator")
+        .def(py::init([](IndexArray feature, InArray threshold, IndexArray left, IndexArray right,
+                         InArray value, IndexArray roots, int max_depth) {
+                 if (value.ndim() != 2) {
+                     throw std::invalid_argument("value must have shape (n_nodes, n_classes)");
+                 }
+                 return eeg::ForestEvaluator(
+                     to_vector(feature), to_vector(threshold), to_vector(left), to_vector(right),
+                     to_vector(value), static_cast<int>(value.shape(1)), to_vector(roots),
+                     max_depth);
+             }),
+             py::arg("feature"), py::arg("threshold"), py::arg("left"), py::arg("right"),
+             py::arg("value"), py::arg("roots"), py::arg("max_depth"))
+        .def_property_readonly("n_classes", &eeg::ForestEvaluator::n_classes)
+        .def(
+            "predict_proba",
+            [](const eeg::ForestEvaluator& forest, FloatArray X) {
+                if (X.ndim() != 2 || X.shape(1) < forest.n_features()) {
+                    throw std::invalid_argument("X must have shape (rows, n_features)");
+                }
+                const std::ptrdiff_t rows = X.shape(0);
+                const int cols = static_cast<int>(X.shape(1));
+                OutArray out({rows, static_cast<std::ptrdiff_t>(forest.n_classes())});
+                const float* x = X.data();
+                double* o = out.mutable_data();
+                {
+                    py::gil_scoped_release release;
+                    forest.predict_proba(x, rows, cols, o);
+                }
+                return out;
+            },
+            py::arg("X"),
+            "Class probabilities of each row of X, shape (rows, n_classes).");
+}
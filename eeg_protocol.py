@@ -0,0 +1,235 @@
+#!/usr/bin/env python3
+"""
+Binary framed serial protocol for the EEG acquisition front-end.
+
+The ASCII format ("Raw: 1425\tVoltage: 1.87", one sample per line) costs
+about 25 bytes per sample and a regex parse on the host. In binary mode
+the device instead sends fixed-size frames:
+
+    offset  size  field
+    0       2     sync word, bytes 0xA5 0x5A
+    2       2     sequence number, uint16 little-endian, +1 per frame
+    4       2*N   raw ADC codes, int16 little-endian, N = channels * samples,
+                  interleaved channel-fastest (s0c0, s0c1, ..., s1c0, ...)
+    4+2*N   2     CRC-16/CCITT-FALSE of bytes 2 .. 4+2*N-1, little-endian
+
+With the default 1 channel x 8 samples a frame is 22 bytes, i.e. under
+3 bytes per sample, and a whole `ser.read(ser.in_waiting)` chunk is
+decoded with a handful of vectorized NumPy operations.
+"""
+
+from __future__ import annotations
+
+from dataclasses import dataclass
+from typing import Tuple
+
+import numpy as np
+
+
+SYNC_BYTES = b"\xa5\x5a"
+# ADS1115 at gain 1 (+/-4.096 V full scale), matching the text-mode voltages
+VOLTS_PER_LSB = 4.096 / 32768.0
+# Sample rates selectable on the calculator.c EEG_FRONTEND keypad
+FRONTEND_RATES = (100, 200, 250, 500)
+
+
+@dataclass(frozen=True)
+class DeviceProfile:
+    """Sample rate and code scale of the device feeding the serial port."""
+
+    fs: float
+    volts_per_lsb: float
+
+
+# The Arduino sketch: ADS1115 at gain 1, paced by delay(10)
+ARDUINO_PROFILE = DeviceProfile(fs=100.0, volts_per_lsb=VOLTS_PER_LSB)
+
+
+def frontend_profile(rate_hz: int = 100, gain: int = 1) -> DeviceProfile:
+    """
+    Profile of the AT89S52 front-end (calculator.c, EEG_FRONTEND).
+
+    Must match the rate and gain set on its keypad, which its LCD shows
+    as e.g. "250Hz x2 5V". The MAX197 runs bipolar at +/-10 V (x1) or
+    +/-5 V (x2), and its 12-bit codes are sent shifted to the int16 range.
+    """
+    if rate_hz not in FRONTEND_RATES:
+        raise ValueError(f"Front-end rate must be one of {FRONTEND_RATES} Hz")
+    if gain not in (1, 2):
+        raise ValueError("Front-end gain must be 1 or 2")
+    return DeviceProfile(fs=float(rate_hz), volts_per_lsb=(20.0 / gain) / 65536.0)
+
+
+def _crc16_table() -> np.ndarray:
+    """Lookup table for CRC-16/CCITT-FALSE (poly 0x1021, MSB first)."""
+    table = np.zeros(256, dtype=np.uint32)
+    for byte in range(256):
+        crc = byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+        table[byte] = crc & 0xFFFF
+    return table
+
+
+_CRC_TABLE = _crc16_table()
+
+
+def crc16_rows(data: np.ndarray) -> np.ndarray:
+    """
+    CRC-16/CCITT-FALSE of every row of a 2D uint8 array at once.
+
+    The loop runs over byte columns, so its cost is one vector operation
+    per frame byte regardless of how many frames are in the chunk.
+    """
+    crc = np.full(data.shape[0], 0xFFFF, dtype=np.uint32)
+    for col in range(data.shape[1]):
+        crc = ((crc << 8) & 0xFFFF) ^ _CRC_TABLE[((crc >> 8) ^ data[:, col]) & 0xFF]
+    return crc
+
+
+@dataclass(frozen=True)
+class FrameFormat:
+    """Fixed frame geometry; must match the firmware build."""
+
+    channels: int = 1
+    samples: int = 8  # samples per channel in each frame
+
+    @property
+    def values(self) -> int:
+        return self.channels * self.samples
+
+    @property
+    def size(self) -> int:
+        return 2 + 2 + 2 * self.values + 2
+
+
+def encode_frames(
+    raw: np.ndarray,
+    fmt: FrameFormat = FrameFormat(),
+    seq_start: int = 0,
+) -> bytes:
+    """
+    Pack raw int16 codes of shape (n_samples, channels) into frames.
+
+    Trailing samples that do not fill a whole frame are dropped. This is
+    the host-side reference for the firmware encoder and for replaying
+    recordings through the binary decoder.
+    """
+    codes = np.asarray(raw, dtype="<i2").reshape(-1, fmt.channels)
+    n_frames = codes.shape[0] // fmt.samples
+    if n_frames == 0:
+        return b""
+
+    frames = np.zeros((n_frames, fmt.size), dtype=np.uint8)
+    frames[:, 0] = SYNC_BYTES[0]
+    frames[:, 1] = SYNC_BYTES[1]
+    seq = (seq_start + np.arange(n_frames)) & 0xFFFF
+    frames[:, 2] = seq & 0xFF
+    frames[:, 3] = seq >> 8
+    payload = codes[: n_frames * fmt.samples].reshape(n_frames, fmt.values)
+    frames[:, 4:-2] = payload.view(np.uint8).reshape(n_frames, 2 * fmt.values)
+    crc = crc16_rows(frames[:, 2:-2])
+    frames[:, -2] = crc & 0xFF
+    frames[:, -1] = crc >> 8
+    return frames.tobytes()
+
+
+class FrameDecoder:
+    """
+    Incremental decoder for a stream of binary frames.
+
+    Feed it whatever `ser.read()` returned; partial frames are carried
+    over to the next call. On a clean stream every chunk is decoded in a
+    single vectorized pass. After corruption the decoder drops the bad
+    frame, counts it and re-synchronises on the next sync word.
+    """
+
+    def __init__(self, fmt: FrameFormat = FrameFormat()) -> None:
+        self.fmt = fmt
+        self._pending = b""
+        self._last_seq: int = -1
+        self.frames = 0
+        self.crc_errors = 0
+        self.dropped_frames = 0  # inferred from sequence number gaps
+        self.skipped_bytes = 0  # bytes discarded while hunting for sync
+
+    def feed(self, chunk: bytes) -> np.ndarray:
+        """
+        Decode all complete frames in `chunk` (plus carried-over bytes).
+
+        Returns raw int16 codes of shape (n_samples, channels).
+        """
+        data = self._pending + chunk
+        buf = np.frombuffer(data, dtype=np.uint8)
+        size = self.fmt.size
+        decoded = []
+        pos = 0
+
+        while True:
+            idx = data.find(SYNC_BYTES, pos)
+            if idx < 0:
+                # Keep a trailing 0xA5 that could start the next sync word
+                keep = 1 if data.endswith(SYNC_BYTES[:1]) else 0
+                end = max(len(data) - keep, pos)
+                self.skipped_bytes += end - pos
+                pos = end
+                break
+            self.skipped_bytes += idx - pos
+            pos = idx
+
+            n = (len(data) - pos) // size
+            if n == 0:
+                break
+
+            frames = buf[pos : pos + n * size].reshape(n, size)
+            crc = frames[:, -2].astype(np.uint32) | (frames[:, -1].astype(np.uint32) << 8)
+            ok = (
+                (frames[:, 0] == SYNC_BYTES[0])
+                & (frames[:, 1] == SYNC_BYTES[1])
+                & (crc16_rows(frames[:, 2:-2]) == crc)
+            )
+            good = n if ok.all() else int(np.argmin(ok))
+            if good:
+                decoded.append(self._unpack(frames[:good]))
+                pos += good * size
+            if good < n:
+                # Frame at `pos` is corrupt or misaligned: skip its sync word
+                self.crc_errors += 1
+                pos += 1
+
+        self._pending = data[pos:]
+        if not decoded:
+            return np.zeros((0, self.fmt.channels), dtype=np.int16)
+        return np.concatenate(decoded, axis=0)
+
+    def _unpack(self, frames: np.ndarray) -> np.ndarray:
+        seq = frames[:, 2].astype(np.int64) | (frames[:, 3].astype(np.int64) << 8)
+        if self._last_seq >= 0:
+            gaps = np.diff(np.concatenate(([self._last_seq], seq))) - 1
+            self.dropped_frames += int(np.sum(gaps & 0xFFFF))
+        self._last_seq = int(seq[-1])
+        self.frames += frames.shape[0]
+
+        payload = np.ascontiguousarray(frames[:, 4:-2]).view("<i2")
+        return payload.reshape(-1, self.fmt.channels).astype(np.int16)
+
+
+def decode_chunk(decoder: FrameDecoder, chunk: bytes) -> Tuple[np.ndarray, np.ndarray]:
+    """Convenience wrapper returning (raw codes, volts) for one chunk."""
+    raw = decoder.feed(chunk)
+    return raw, raw * VOLTS_PER_LSB
+
+
+__all__ = [
+    "DeviceProfile",
+    "ARDUINO_PROFILE",
+    "FRONTEND_RATES",
+    "frontend_profile",
+    "FrameFormat",
+    "FrameDecoder",
+    "encode_frames",
+    "decode_chunk",
+    "crc16_rows",
+    "VOLTS_PER_LSB",
+    "SYNC_BYTES",
+]
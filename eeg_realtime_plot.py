@@ -22,18 +22,20 @@ import re
 import sys
 import threading
 import time
-from collections import deque
-from typing import Deque, Optional
+from typing import Optional
 
 import matplotlib.pyplot as plt
 import numpy as np
 import serial
 from matplotlib.animation import FuncAnimation
 
+from eeg_buffer import RingBuffer
+
 
 SERIAL_PORT = "/dev/cu.usbmodem214101"  # macOS Arduino port
 BAUD_RATE = 9600                        # Match your Arduino sketch (Serial.begin(9600))
 SAMPLES_TO_SHOW = 500                   # Number of samples visible in the window
+BUFFER_CAPACITY = 4 * SAMPLES_TO_SHOW   # Ring headroom so the reader cannot lap a frame
 READ_TIMEOUT = 1.0                      # Seconds
 
 
@@ -41,13 +43,15 @@ class SerialReader(threading.Thread):
     """
     Background thread that reads samples from the serial port and
     pushes them into a fixed-length buffer.
+
+    This thread is the single producer of `buffer`.
     """
 
     def __init__(
         self,
         port: str,
         baud_rate: int,
-        buffer: Deque[float],
+        buffer: RingBuffer,
         stop_event: threading.Event,
     ) -> None:
         super().__init__(daemon=True)
@@ -133,7 +137,7 @@ class SerialReader(threading.Thread):
 
 
 def main() -> None:
-    buffer: Deque[float] = deque(maxlen=SAMPLES_TO_SHOW)
+    buffer = RingBuffer(BUFFER_CAPACITY)
     stop_event = threading.Event()
 
     reader = SerialReader(
@@ -166,20 +170,12 @@ def main() -> None:
 
     def update(_frame):
         if buffer:
-            data = np.array(list(buffer), dtype=float)
-
-            # If fewer than SAMPLES_TO_SHOW samples, left-pad with last value (or zero)
-            if data.size < SAMPLES_TO_SHOW:
-                if data.size == 0:
-                    padded = np.zeros(SAMPLES_TO_SHOW)
-                else:
-                    pad_value = data[0]
-                    pad_len = SAMPLES_TO_SHOW - data.size
-                    padded = np.concatenate(
-                        [np.full(pad_len, pad_value, dtype=float), data]
-                    )
-            else:
-                padded = data[-SAMPLES_TO_SHOW:]
+            # Copy the newest samples into the preallocated y array and
+            # left-pad with the oldest one until the buffer has filled up
+            padded = y
+            n = buffer.copy_latest(padded)
+            if n < SAMPLES_TO_SHOW:
+                padded[: SAMPLES_TO_SHOW - n] = padded[SAMPLES_TO_SHOW - n]
 
             line.set_ydata(padded)
 
@@ -0,0 +1,496 @@
+#!/usr/bin/env python3
+"""
+Recording formats and writers for acquisition logs in data/.
+
+Two on-disk formats are supported:
+    - CSV (`timestamp_iso,raw,voltage`), the original human-readable log.
+    - Columnar binary (`.eegrec`): a 64-byte header followed by one
+      contiguous int16 raw column and one float32 voltage column, opened
+      with np.memmap so even hour-long sessions load instantly.
+      Multi-channel recordings store (n, channels) rows in each column.
+
+Multi-channel CSV logs use `raw_<c>` / `voltage_<c>` columns per channel.
+
+The serial reader thread must never wait on the disk, so logging runs on
+its own thread: the reader stages samples into blocks and hands them over
+through a bounded queue, and the writer formats and writes whole batches.
+
+Convert existing CSV logs with:
+    python eeg_recording.py data/*.csv
+"""
+
+from __future__ import annotations
+
+import argparse
+import csv
+import os
+import queue
+import shutil
+import struct
+import sys
+import threading
+import time
+from dataclasses import dataclass
+from datetime import datetime
+from typing import IO, Any, List, Optional, Tuple
+
+import numpy as np
+
+from eeg_features import DEFAULT_FS
+from eeg_protocol import VOLTS_PER_LSB
+
+
+CSV_HEADER = "timestamp_iso,raw,voltage\n"
+# Raw-code placeholder for text lines that only carried a voltage
+RAW_MISSING = np.iinfo(np.int64).min
+
+BINARY_EXT = ".eegrec"
+REC_MAGIC = b"EEGREC\x00\x01"
+REC_VERSION = 1
+# magic, version, channels, fs, start (unix us), n_samples, voltage offset, volts/LSB
+_REC_HEADER = struct.Struct("<8sHHdqQQd")
+REC_HEADER_SIZE = 64
+# int16 cannot hold RAW_MISSING; the most negative code stands in for it
+REC_RAW_MISSING = -32768
+
+_Block = Tuple[float, np.ndarray, np.ndarray]
+
+
+class _BlockRecorder(threading.Thread):
+    """
+    Background writer fed with sample blocks by a single producer.
+
+    Each block records the monotonic time at which it was handed over;
+    the writer assigns its samples times spaced 1/fs apart, ending at that
+    instant. Subclasses implement `_open`, `_write_batch` and `_finish`.
+
+    If the queue is full the block is dropped rather than stalling the
+    producer; `dropped_samples` counts those, `lag_samples` how many
+    submitted samples have not reached the file yet.
+    """
+
+    def __init__(
+        self,
+        path: str,
+        fs: float = DEFAULT_FS,
+        block_size: int = 256,
+        max_blocks: int = 256,
+        flush_interval: float = 0.5,
+        channels: int = 1,
+    ) -> None:
+        super().__init__(daemon=True)
+        self.path = path
+        self.fs = float(fs)
+        self.channels = int(channels)
+        self.block_size = int(block_size)
+        self.flush_interval = float(flush_interval)
+        self._queue: "queue.Queue[Optional[_Block]]" = queue.Queue(maxsize=max_blocks)
+
+        # Producer-side staging for one-sample-at-a-time sources
+        self._stage_raw: List[Any] = []
+        self._stage_volts: List[Any] = []
+        self._last_submit = time.monotonic()
+
+        # Wall-clock anchor for converting monotonic times to timestamps
+        self._mono0 = time.monotonic()
+        self._wall0 = np.datetime64(datetime.utcnow(), "us")
+
+        self.submitted_samples = 0  # producer-owned
+        self.written_samples = 0  # writer-owned
+        self.dropped_samples = 0  # producer-owned
+
+        os.makedirs(os.path.dirname(path) or ".", exist_ok=True)
+
+    # ---------------- producer side ----------------
+    def append(self, raw: Any, voltage: Any) -> None:
+        """
+        Stage one sample; submitted together with its block.
+
+        For multi-channel recorders both arguments are per-channel
+        sequences; `raw` may be None when the source only sent voltages.
+        """
+        if raw is None:
+            raw = RAW_MISSING if self.channels == 1 else [RAW_MISSING] * self.channels
+        self._stage_raw.append(raw)
+        self._stage_volts.append(voltage)
+        if (
+            len(self._stage_raw) >= self.block_size
+            or time.monotonic() - self._last_submit >= self.flush_interval
+        ):
+            self.flush()
+
+    def write_block(self, raw: np.ndarray, volts: np.ndarray) -> None:
+        """Submit a block of samples; (n,) or (n, channels) arrays."""
+        self.flush()
+        self._submit(np.asarray(raw, dtype=np.int64), np.asarray(volts, dtype=float))
+
+    def flush(self) -> None:
+        """Submit any staged samples."""
+        self._last_submit = time.monotonic()
+        if not self._stage_raw:
+            return
+        raw = np.array(self._stage_raw, dtype=np.int64)
+        volts = np.array(self._stage_volts, dtype=float)
+        self._stage_raw.clear()
+        self._stage_volts.clear()
+        self._submit(raw, volts)
+
+    def _submit(self, raw: np.ndarray, volts: np.ndarray) -> None:
+        raw = raw.reshape(-1, self.channels)
+        volts = volts.reshape(-1, self.channels)
+        n = raw.shape[0]
+        if n == 0:
+            return
+        try:
+            self._queue.put_nowait((time.monotonic(), raw, volts))
+            self.submitted_samples += n
+        except queue.Full:
+            self.dropped_samples += n
+
+    def close(self, timeout: float = 5.0) -> None:
+        """Flush, tell the writer to finish and wait for it."""
+        self.flush()
+        self._queue.put(None)
+        self.join(timeout=timeout)
+        if self.dropped_samples:
+            print(
+                f"[WARN] Recorder fell behind, {self.dropped_samples} samples "
+                f"not logged to {self.path}",
+                file=sys.stderr,
+            )
+
+    @property
+    def lag_samples(self) -> int:
+        """Samples handed to the writer that are not on disk yet."""
+        return self.submitted_samples - self.written_samples
+
+    # ---------------- writer side ----------------
+    def run(self) -> None:
+        self._open()
+        try:
+            done = False
+            while not done:
+                block = self._queue.get()
+                batch = []
+                while block is not None:
+                    batch.append(block)
+                    try:
+                        block = self._queue.get_nowait()
+                    except queue.Empty:
+                        break
+                else:
+                    done = True
+
+                if batch:
+                    self._write_batch(batch)
+                    self.written_samples += sum(b[1].shape[0] for b in batch)
+        finally:
+            self._finish()
+
+    def _timestamps(self, batch: List[_Block]) -> np.ndarray:
+        """datetime64[us] timestamp for every sample in the batch."""
+        times = []
+        for t_mono, raw, _volts in batch:
+            back = np.arange(raw.shape[0] - 1, -1, -1, dtype=float) / self.fs
+            times.append(t_mono - self._mono0 - back)
+        offsets_us = (np.concatenate(times) * 1e6).astype(np.int64)
+        return self._wall0 + offsets_us.astype("timedelta64[us]")
+
+    def _open(self) -> None:
+        raise NotImplementedError
+
+    def _write_batch(self, batch: List[_Block]) -> None:
+        raise NotImplementedError
+
+    def _finish(self) -> None:
+        raise NotImplementedError
+
+
+class CsvRecorder(_BlockRecorder):
+    """Writes `timestamp_iso,raw,voltage` rows, one buffered chunk per batch."""
+
+    def _open(self) -> None:
+        self._file: IO[str] = open(self.path, mode="w", newline="", buffering=1 << 20)
+        self._file.write(csv_header(self.channels))
+
+    def _write_batch(self, batch: List[_Block]) -> None:
+        ts = np.datetime_as_string(self._timestamps(batch), unit="us")
+        raw = np.concatenate([b[1] for b in batch])
+        raw_str = np.where(raw == RAW_MISSING, "", raw.astype(str))
+        volt_str = np.concatenate([b[2] for b in batch]).astype(str)
+
+        if self.channels == 1:
+            rows = (f"{t},{r},{v}\n" for t, r, v in zip(ts, raw_str[:, 0], volt_str[:, 0]))
+        else:
+            cols = [ts] + list(raw_str.T) + list(volt_str.T)
+            rows = (",".join(row) + "\n" for row in zip(*cols))
+        self._file.write("".join(rows))
+        self._file.flush()
+
+    def _finish(self) -> None:
+        self._file.close()
+
+
+class BinaryRecorder(_BlockRecorder):
+    """
+    Writes the columnar `.eegrec` format.
+
+    The raw column is streamed straight after the header; voltages go to a
+    `.part` side file that is appended on close, when the header is
+    patched with the sample count. A session that never closed still has
+    a readable raw column (see `open_recording`). `volts_per_lsb` is
+    the device's code scale, stored in the header.
+    """
+
+    def __init__(self, path: str, volts_per_lsb: float = VOLTS_PER_LSB, **kwargs: Any) -> None:
+        super().__init__(path, **kwargs)
+        self.volts_per_lsb = float(volts_per_lsb)
+
+    def _open(self) -> None:
+        self._file: IO[bytes] = open(self.path, mode="wb", buffering=1 << 20)
+        self._volts_path = self.path + ".part"
+        self._volts_file: IO[bytes] = open(self._volts_path, mode="wb", buffering=1 << 20)
+        self._start_us = 0
+        self._file.write(self._header(0, 0))
+
+    def _header(self, n_samples: int, voltage_offset: int) -> bytes:
+        header = _REC_HEADER.pack(
+            REC_MAGIC,
+            REC_VERSION,
+            self.channels,
+            self.fs,
+            self._start_us,
+            n_samples,
+            voltage_offset,
+            self.volts_per_lsb,
+        )
+        return header.ljust(REC_HEADER_SIZE, b"\x00")
+
+    def _write_batch(self, batch: List[_Block]) -> None:
+        if self._start_us == 0:
+            first = self._timestamps(batch[:1])[0]
+            self._start_us = int(first.astype("datetime64[us]").astype(np.int64))
+
+        raw = np.concatenate([b[1] for b in batch])
+        raw = np.where(raw == RAW_MISSING, REC_RAW_MISSING, raw).astype("<i2")
+        volts = np.concatenate([b[2] for b in batch]).astype("<f4")
+        self._file.write(raw.tobytes())
+        self._volts_file.write(volts.tobytes())
+
+    def _finish(self) -> None:
+        n = self.written_samples
+        values = n * self.channels
+        voltage_offset = _voltage_offset(values)
+        self._volts_file.close()
+        self._file.write(b"\x00" * (voltage_offset - REC_HEADER_SIZE - 2 * values))
+        with open(self._volts_path, "rb") as src:
+            shutil.copyfileobj(src, self._file, length=1 << 20)
+        self._file.seek(0)
+        self._file.write(self._header(n, voltage_offset))
+        self._file.close()
+        os.remove(self._volts_path)
+
+
+def _voltage_offset(n_values: int) -> int:
+    """Byte offset of the float32 column, 4-byte aligned after the raw one."""
+    end_raw = REC_HEADER_SIZE + 2 * n_values
+    return (end_raw + 3) & ~3
+
+
+def csv_header(channels: int = 1) -> str:
+    if channels == 1:
+        return CSV_HEADER
+    raw = [f"raw_{c}" for c in range(channels)]
+    volts = [f"voltage_{c}" for c in range(channels)]
+    return ",".join(["timestamp_iso"] + raw + volts) + "\n"
+
+
+@dataclass
+class Recording:
+    """A loaded recording; columns may be memory-mapped views."""
+
+    path: str
+    fs: float
+    start: np.datetime64
+    raw: np.ndarray  # int16 codes (REC_RAW_MISSING where unknown)
+    voltage: np.ndarray  # float32 volts, (n,) or (n, channels)
+
+    def __len__(self) -> int:
+        return int(self.voltage.shape[0])
+
+    @property
+    def channels(self) -> int:
+        return 1 if self.voltage.ndim == 1 else int(self.voltage.shape[1])
+
+
+def open_recording(path: str) -> Recording:
+    """
+    Open a `.eegrec` recording through np.memmap or parse a CSV log.
+
+    For a binary session whose writer did not close cleanly (sample count
+    still 0 in the header), the raw column is recovered from the file
+    size and the voltages from the `.part` side file the writer left
+    next to it. Samples missing from that file are rebuilt from their raw
+    codes, or NaN where the source only sent voltages (text mode).
+    """
+    if not path.endswith(BINARY_EXT):
+        return _read_csv(path)
+
+    with open(path, "rb") as f:
+        header = f.read(REC_HEADER_SIZE)
+    if len(header) < REC_HEADER_SIZE or header[:8] != REC_MAGIC:
+        raise ValueError(f"{path} is not an EEG binary recording")
+    _magic, version, channels, fs, start_us, n, voltage_offset, volts_per_lsb = (
+        _REC_HEADER.unpack_from(header)
+    )
+    if version != REC_VERSION or channels < 1:
+        raise ValueError(f"Unsupported recording version/channels in {path}")
+    start = np.datetime64(start_us, "us")
+    shape: Tuple[int, ...]
+
+    if n == 0:
+        n = (os.path.getsize(path) - REC_HEADER_SIZE) // (2 * channels)
+        shape = (n,) if channels == 1 else (n, channels)
+        if n == 0:
+            empty = np.zeros(shape, dtype=np.int16)
+            return Recording(path, fs, start, empty, empty.astype(np.float32))
+        raw = np.memmap(path, dtype="<i2", mode="r", offset=REC_HEADER_SIZE, shape=shape)
+        voltage = _recover_voltage(path + ".part", raw, channels, volts_per_lsb)
+        return Recording(path, fs, start, raw, voltage)
+
+    shape = (n,) if channels == 1 else (n, channels)
+    raw = np.memmap(path, dtype="<i2", mode="r", offset=REC_HEADER_SIZE, shape=shape)
+    voltage = np.memmap(path, dtype="<f4", mode="r", offset=voltage_offset, shape=shape)
+    return Recording(path, fs, start, raw, voltage)
+
+
+def _recover_voltage(
+    part_path: str,
+    raw: np.ndarray,
+    channels: int,
+    volts_per_lsb: float,
+) -> np.ndarray:
+    """Voltages of an unclosed recording: `.part` first, then from raw codes."""
+    voltage = (raw * volts_per_lsb).astype(np.float32)
+    voltage[raw == REC_RAW_MISSING] = np.nan
+    if os.path.exists(part_path):
+        # Both files are buffered, so either may have lost its last writes
+        n = min(os.path.getsize(part_path) // (4 * channels), raw.shape[0])
+        part = np.fromfile(part_path, dtype="<f4", count=n * channels)
+        voltage[:n] = part.reshape(voltage[:n].shape)
+    return voltage
+
+
+def _read_csv(path: str, fs: float = DEFAULT_FS) -> Recording:
+    """
+    Parse a CSV log (single `voltage` or per-channel `voltage_<c>`
+    columns), skipping malformed rows.
+    """
+    raw: List[List[int]] = []
+    voltage: List[List[float]] = []
+    first_ts: Optional[str] = None
+    with open(path, newline="") as f:
+        reader = csv.reader(f)
+        header = next(reader, [])
+        if "voltage" in header:
+            v_cols = [header.index("voltage")]
+            r_cols = [header.index("raw") if "raw" in header else -1]
+        else:
+            v_cols = [i for i, name in enumerate(header) if name.startswith("voltage_")]
+            r_cols = []
+            for i in v_cols:
+                raw_name = "raw_" + header[i][len("voltage_") :]
+                r_cols.append(header.index(raw_name) if raw_name in header else -1)
+        ts_col = header.index("timestamp_iso") if "timestamp_iso" in header else -1
+
+        for row in reader:
+            try:
+                v = [float(row[i]) for i in v_cols]
+            except (ValueError, IndexError):
+                continue
+            r = []
+            for i in r_cols:
+                try:
+                    r.append(int(row[i]) if i >= 0 else REC_RAW_MISSING)
+                except (ValueError, IndexError):
+                    r.append(REC_RAW_MISSING)
+            if first_ts is None and ts_col >= 0:
+                first_ts = row[ts_col]
+            raw.append(r)
+            voltage.append(v)
+
+    try:
+        start = np.datetime64(first_ts, "us") if first_ts else np.datetime64(0, "us")
+    except ValueError:
+        start = np.datetime64(0, "us")
+
+    channels = max(len(v_cols), 1)
+    raw_arr = np.array(raw, dtype=np.int16).reshape(-1, channels)
+    volt_arr = np.array(voltage, dtype=np.float32).reshape(-1, channels)
+    if channels == 1:
+        raw_arr, volt_arr = raw_arr[:, 0], volt_arr[:, 0]
+    return Recording(path, fs, start, raw_arr, volt_arr)
+
+
+def write_recording(path: str, rec: Recording, volts_per_lsb: float = VOLTS_PER_LSB) -> None:
+    """Write a whole in-memory recording in the binary format."""
+    n = len(rec)
+    values = n * rec.channels
+    voltage_offset = _voltage_offset(values)
+    start_us = int(rec.start.astype("datetime64[us]").astype(np.int64))
+    header = _REC_HEADER.pack(
+        REC_MAGIC, REC_VERSION, rec.channels, rec.fs, start_us, n, voltage_offset, volts_per_lsb
+    ).ljust(REC_HEADER_SIZE, b"\x00")
+
+    with open(path, "wb") as f:
+        f.write(header)
+        f.write(np.asarray(rec.raw, dtype="<i2").tobytes())
+        f.write(b"\x00" * (voltage_offset - REC_HEADER_SIZE - 2 * values))
+        f.write(np.asarray(rec.voltage, dtype="<f4").tobytes())
+
+
+def convert_csv(csv_path: str, out_path: Optional[str] = None) -> str:
+    """Convert one CSV log to `.eegrec` next to it; returns the new path."""
+    if out_path is None:
+        out_path = os.path.splitext(csv_path)[0] + BINARY_EXT
+    write_recording(out_path, _read_csv(csv_path))
+    return out_path
+
+
+__all__ = [
+    "CsvRecorder",
+    "BinaryRecorder",
+    "Recording",
+    "open_recording",
+    "write_recording",
+    "convert_csv",
+    "CSV_HEADER",
+    "csv_header",
+    "BINARY_EXT",
+]
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(
+        description="Convert EEG CSV logs to the columnar binary recording format."
+    )
+    parser.add_argument("csv", nargs="+", help="CSV log files to convert.")
+    parser.add_argument(
+        "--force",
+        action="store_true",
+        help="Overwrite existing .eegrec files.",
+    )
+    args = parser.parse_args()
+
+    for csv_path in args.csv:
+        out_path = os.path.splitext(csv_path)[0] + BINARY_EXT
+        if os.path.exists(out_path) and not args.force:
+            print(f"[INFO] Skipping {csv_path}: {out_path} exists")
+            continue
+        convert_csv(csv_path, out_path)
+        print(f"[INFO] {csv_path} -> {out_path}")
+
+
+if __name__ == "__main__":
+    main()
+
@@ -0,0 +1,251 @@
+#!/usr/bin/env python3
+"""
+Replay recorded sessions through the live acquisition pipeline.
+
+`ReplayReader` is a drop-in stand-in for eeg_gui.SerialReader: the same
+thread interface (buffer, stop_event, `recorder` attribute), but the
+samples come from an existing data/eeg_*.csv or .eegrec recording
+instead of a serial port. It publishes blocks at 1x, Nx or
+as-fast-as-possible speed (speed = 0), passing them through the same
+live filter stage first, so plotting and classification can be
+exercised and timed without a device attached.
+
+Headless use, to measure throughput and regression-test classification
+on a recorded session:
+    python eeg_replay.py data/eeg_20250101_120000.eegrec --speed 0
+"""
+
+from __future__ import annotations
+
+import argparse
+import os
+import sys
+import threading
+import time
+from collections import Counter
+from typing import Optional
+
+import numpy as np
+
+from eeg_buffer import RingBuffer
+from eeg_features import IncrementalFeatures, extract_features_multichannel
+from eeg_filters import StreamingFilter
+from eeg_forest import FOREST_PATH, FlatForest
+from eeg_metrics import Metrics
+from eeg_recording import open_recording
+
+
+BLOCK_SAMPLES = 8  # samples per publish, one binary frame's worth
+CLASSIFY_STEP_SECONDS = 0.25  # headless mode: classify every this much signal
+
+
+class ReplayReader(threading.Thread):
+    """
+    Background thread that publishes a recording into `buffer`.
+
+    speed is the replay rate relative to real time (1.0 = as recorded,
+    10.0 = ten times faster, 0 = no pacing at all). Blocks are paced
+    against the monotonic clock, so sleep jitter never accumulates.
+    Like SerialReader this thread is the single producer of `buffer`.
+    """
+
+    def __init__(
+        self,
+        path: str,
+        buffer: RingBuffer,
+        stop_event: threading.Event,
+        speed: float = 1.0,
+        live_filter: bool = True,
+        block_samples: int = BLOCK_SAMPLES,
+        loop: bool = False,
+        metrics: Optional[Metrics] = None,
+    ) -> None:
+        super().__init__(daemon=True)
+        if speed < 0:
+            raise ValueError("speed must be >= 0")
+        self._path = path
+        self._buffer = buffer
+        self._stop_event = stop_event
+        self._speed = float(speed)
+        self._live_filter = live_filter
+        self._block = max(int(block_samples), 1)
+        self._loop = loop
+        # No log is written during replay; kept for SerialReader parity
+        self.recorder = None
+        metrics = metrics if metrics is not None else Metrics()
+        self._samples = metrics.counter("samples_parsed", "Samples published to the buffer")
+
+        self.fs = 0.0
+        self.published_samples = 0
+        self.started_at = 0.0
+        self.finished_at = 0.0
+        self.finished = threading.Event()
+
+    @property
+    def elapsed(self) -> float:
+        end = self.finished_at if self.finished.is_set() else time.monotonic()
+        return max(end - self.started_at, 0.0) if self.started_at else 0.0
+
+    @property
+    def throughput(self) -> float:
+        """Samples published per wall-clock second so far."""
+        elapsed = self.elapsed
+        return self.published_samples / elapsed if elapsed > 0 else 0.0
+
+    def run(self) -> None:
+        try:
+            rec = open_recording(self._path)
+        except (OSError, ValueError) as exc:
+            print(f"[ERROR] Could not open recording {self._path}: {exc}", file=sys.stderr)
+            self.finished.set()
+            return
+
+        volts = rec.voltage
+        if self._buffer.channels is None and volts.ndim == 2:
+            # Single-channel pipeline: replay the first channel
+            volts = volts[:, 0]
+        self.fs = rec.fs
+        n = volts.shape[0]
+        print(
+            f"[INFO] Replaying {self._path} ({n} samples at {rec.fs:g} Hz, "
+            f"speed {'max' if self._speed == 0 else f'{self._speed:g}x'})"
+        )
+
+        self.started_at = time.monotonic()
+        try:
+            while not self._stop_event.is_set():
+                self._replay_once(volts, rec.fs)
+                if not self._loop:
+                    break
+        finally:
+            self.finished_at = time.monotonic()
+            self.finished.set()
+
+        print(
+            f"[INFO] Replay stopped: {self.published_samples} samples in "
+            f"{self.elapsed:.2f} s ({self.throughput:.0f} samples/s)"
+        )
+
+    def _replay_once(self, volts: np.ndarray, fs: float) -> None:
+        filt = None
+        if self._live_filter:
+            filt = StreamingFilter(fs, channels=self._buffer.channels)
+        t0 = time.monotonic()
+        rate = fs * self._speed
+        n = volts.shape[0]
+        for start in range(0, n, self._block):
+            if self._stop_event.is_set():
+                return
+            if rate > 0:
+                delay = t0 + start / rate - time.monotonic()
+                if delay > 0:
+                    self._stop_event.wait(delay)
+
+            block = np.asarray(volts[start : start + self._block], dtype=float)
+            if filt is not None:
+                block = filt.process(block)
+            self._buffer.extend(block)
+            self.published_samples += block.shape[0]
+            self._samples.add(block.shape[0])
+
+            if rate == 0 and start % (64 * self._block) == 0:
+                # Unpaced: still let consumer threads take the GIL
+                time.sleep(0)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(
+        description="Replay a recording through the acquisition pipeline (headless)."
+    )
+    parser.add_argument("path", help="Recording to replay (.eegrec or CSV log).")
+    parser.add_argument(
+        "--speed",
+        type=float,
+        default=1.0,
+        help="Replay speed relative to real time; 0 = as fast as possible.",
+    )
+    parser.add_argument("--window-seconds", type=float, default=3.0)
+    parser.add_argument("--model", default=FOREST_PATH, help="Flattened forest (.npz).")
+    parser.add_argument("--no-filter", action="store_true", help="Skip the live filter stage.")
+    args = parser.parse_args()
+
+    rec = open_recording(args.path)
+    channels = rec.channels if rec.channels > 1 else None
+    window = int(args.window_seconds * rec.fs)
+    step = max(int(CLASSIFY_STEP_SECONDS * rec.fs), 1)
+    buffer = RingBuffer(16 * window, channels=channels)
+
+    model = FlatForest.load(args.model) if os.path.exists(args.model) else None
+    if model is None:
+        print(f"[INFO] No model at {args.model}; measuring throughput only.")
+
+    stop_event = threading.Event()
+    reader = ReplayReader(
+        args.path, buffer, stop_event, speed=args.speed, live_filter=not args.no_filter
+    )
+
+    # Consumer: the classification worker's catch-up loop, without Qt
+    feats = IncrementalFeatures(window, rec.fs) if channels is None else None
+    scratch = np.zeros((channels, window)) if channels else None
+    consumed = 0
+    next_classify = window
+    overruns = 0
+    max_lag = 0
+    votes: Counter = Counter()
+    infer_time = 0.0
+    n_infer = 0
+
+    reader.start()
+    try:
+        while True:
+            done = reader.finished.is_set()
+            written = buffer.written
+            new = written - consumed
+            max_lag = max(max_lag, new)
+            if new > buffer.capacity:
+                overruns += 1
+                if feats is not None:
+                    feats.reset()
+                new = buffer.capacity
+            if feats is not None and new:
+                for part in buffer.views(new, written):
+                    feats.push(part)
+            consumed = written
+
+            if model is not None and written >= next_classify:
+                t = time.perf_counter()
+                if feats is not None:
+                    x = feats.features()
+                else:
+                    buffer.copy_latest(scratch, written)
+                    x = extract_features_multichannel(scratch)
+                votes[int(model.predict(x)[0])] += 1
+                infer_time += time.perf_counter() - t
+                n_infer += 1
+                # Skip ahead if we fell behind rather than classify stale windows
+                next_classify = max(next_classify + step, written - written % step)
+
+            if done and consumed == buffer.written:
+                break
+            if not new:
+                time.sleep(0.001)
+    except KeyboardInterrupt:
+        stop_event.set()
+    reader.join()
+
+    print(f"[INFO] Throughput: {reader.throughput:.0f} samples/s")
+    print(f"[INFO] Consumer: max lag {max_lag} samples, {overruns} overruns")
+    if n_infer:
+        print(
+            f"[INFO] {n_infer} classifications, "
+            f"{1e3 * infer_time / n_infer:.3f} ms per window (features + predict)"
+        )
+        for cls, count in sorted(votes.items()):
+            print(f"  class {cls}: {count} windows ({100.0 * count / n_infer:.1f}%)")
+
+
+__all__ = ["ReplayReader", "BLOCK_SAMPLES"]
+
+
+if __name__ == "__main__":
+    main()
@@ -17,32 +17,86 @@ Expected dataset format (CSV):
 You can adapt the `load_dataset` function to match the actual format
 of whatever EEG dataset you use.
 
+Alternatively, label whole recordings made by the GUI (CSV or the binary
+.eegrec format, which is memory-mapped rather than loaded). Each recording
+is cut into non-overlapping windows of --window-seconds:
+    python train_classifier.py --recording relaxed=data/eeg_a.eegrec \
+                               --recording focused=data/eeg_b.eegrec
+
+Datasets are streamed in chunks of --chunk-rows segments, so only the
+9-column feature matrix has to fit in memory. Add --cache-features to keep
+computed features on disk; re-training on an unchanged file then skips
+featurization entirely.
+
+Segments and recordings go through the same notch + bandpass stage as the
+live GUI (eeg_filters.py) before featurization; --no-filter turns it off.
+
 Usage example:
     python train_classifier.py --data path/to/eeg_dataset.csv
 
+--search replaces the single fixed forest with a cross-validated search
+over forest sizes/depths and compact alternatives (gradient boosting, a
+linear model on log band powers), run in parallel over memory-mapped
+features. Every candidate is scored on accuracy and on measured
+single-window inference latency; the most accurate model on the Pareto
+front (within --latency-budget-ms, if given) is saved, and the scores
+of all candidates are written next to it (models/eeg_state_model.json):
+    python train_classifier.py --data path/to/eeg_dataset.csv --search \
+                               --latency-budget-ms 0.5
+
 The trained model will be saved as:
     models/eeg_state_model.pkl
+together with a flattened copy for fast inference (see eeg_forest.py):
+    models/eeg_state_forest.npz
 which is automatically loaded by the GUI (if present).
 """
 
 from __future__ import annotations
 
 import argparse
+import hashlib
+import json
 import os
-from typing import Tuple
+import subprocess
+import sys
+import tempfile
+import time
+from concurrent.futures import ThreadPoolExecutor
+from typing import Any, Callable, Dict, Iterator, List, Optional, Sequence, Tuple
 
 import joblib
 import numpy as np
 import pandas as pd
-from sklearn.ensemble import RandomForestClassifier
+from joblib import Parallel, delayed
+from sklearn.base import clone
+from sklearn.ensemble import HistGradientBoostingClassifier, RandomForestClassifier
+from sklearn.linear_model import LogisticRegression
 from sklearn.metrics import classification_report
-from sklearn.model_selection import train_test_split
-
-from eeg_features import extract_features, DEFAULT_FS
+from sklearn.model_selection import StratifiedKFold, train_test_split
+from sklearn.pipeline import make_pipeline
+from sklearn.preprocessing import FunctionTransformer, StandardScaler
+from sklearn.tree import DecisionTreeClassifier
+
+from eeg_features import (
+    BANDS,
+    N_FEATURES,
+    extract_features_batch,
+    extract_features_multichannel,
+    log_band_powers,
+    DEFAULT_FS,
+)
+from eeg_filters import BANDPASS_HZ, MAINS_HZ, StreamingFilter, filter_signal
+from eeg_forest import FOREST_PATH, flatten_forest
+from eeg_hashing import file_sha256
+from eeg_recording import open_recording
 
 
 MODEL_DIR = "models"
 MODEL_PATH = os.path.join(MODEL_DIR, "eeg_state_model.pkl")
+PROFILE_PATH = os.path.join(MODEL_DIR, "eeg_state_model.json")
+FEATURE_CACHE_DIR = os.path.join("cache", "features")
+FEATURE_CACHE_VERSION = 1  # bump when extract_features changes its output
+DEFAULT_CHUNK_ROWS = 4096  # raw segments held in memory at a time
 
 CLASS_MAP_STR_TO_INT = {
     "relaxed": 0,
@@ -51,51 +105,237 @@ CLASS_MAP_STR_TO_INT = {
 }
 
 
-def load_dataset(path: str) -> Tuple[np.ndarray, np.ndarray]:
+def _normalize_labels(labels: np.ndarray) -> np.ndarray:
+    """Map string labels to ints if needed."""
+    if labels.dtype.kind in {"U", "S", "O"}:
+        return np.array(
+            [CLASS_MAP_STR_TO_INT[str(lbl).strip().lower()] for lbl in labels],
+            dtype=int,
+        )
+    return labels.astype(int)
+
+
+def _featurize_segments(X_raw: np.ndarray, filtered: bool) -> np.ndarray:
+    if filtered:
+        X_raw = filter_signal(X_raw, fs=DEFAULT_FS, axis=1)
+    return extract_features_batch(X_raw, fs=DEFAULT_FS)
+
+
+def iter_dataset_chunks(
+    path: str,
+    chunk_rows: int = DEFAULT_CHUNK_ROWS,
+    filtered: bool = True,
+    workers: Optional[int] = None,
+) -> Iterator[Tuple[np.ndarray, np.ndarray]]:
     """
-    Load an external EEG dataset and return (X, y).
+    Stream an external EEG dataset as featurized (X, y) chunks.
 
-    This implementation expects:
-        - All columns starting with "voltage_" are raw EEG samples
-        - A column named "label" with values in {0,1,2} or {"Relaxed",...}
+    Only `chunk_rows` raw segments are held in memory at a time; each
+    chunk is replaced by its 9-column feature matrix before the next one
+    is read. With `filtered`, every segment first goes through the same
+    notch + bandpass stage as the live GUI (see eeg_filters).
 
-    Adapt this function if your dataset has a different structure.
+    Each chunk is split into row slices filtered and featurized on
+    `workers` threads (all cores by default); SciPy's filters and
+    NumPy's FFT release the GIL.
     """
-    df = pd.read_csv(path)
-    if "label" not in df.columns:
+    columns = pd.read_csv(path, nrows=0).columns
+    if "label" not in columns:
         raise ValueError("Dataset must contain a 'label' column.")
 
     # Select voltage columns (flexible: any column name starting with 'voltage')
-    voltage_cols = [c for c in df.columns if c.startswith("voltage_")]
+    voltage_cols = [c for c in columns if c.startswith("voltage_")]
     if not voltage_cols:
         raise ValueError(
             "Dataset must have columns named like 'voltage_0', 'voltage_1', ..."
         )
 
-    X_raw = df[voltage_cols].to_numpy(dtype=float)
-    labels = df["label"].to_numpy()
-
-    # Map string labels to ints if needed
-    if labels.dtype.kind in {"U", "S", "O"}:
-        labels_norm = np.array(
-            [CLASS_MAP_STR_TO_INT[str(lbl).strip().lower()] for lbl in labels],
-            dtype=int,
-        )
-    else:
-        labels_norm = labels.astype(int)
-
-    # Convert each row (segment) to feature vector
-    feats = []
-    for row in X_raw:
-        feats.append(extract_features(row, fs=DEFAULT_FS))
-    X = np.stack(feats, axis=0)
+    n_workers = workers or os.cpu_count() or 1
+    reader = pd.read_csv(path, usecols=voltage_cols + ["label"], chunksize=chunk_rows)
+    with ThreadPoolExecutor(max_workers=n_workers) as pool, reader:
+        for df in reader:
+            X_raw = df[voltage_cols].to_numpy(dtype=float)
+            y = _normalize_labels(df["label"].to_numpy())
+            # Rows are independent, so slices give the same features
+            step = max(-(-X_raw.shape[0] // n_workers), 1)
+            jobs = [
+                pool.submit(_featurize_segments, X_raw[i : i + step], filtered)
+                for i in range(0, X_raw.shape[0], step)
+            ]
+            yield np.concatenate([job.result() for job in jobs], axis=0), y
+
+
+def load_dataset(
+    path: str,
+    chunk_rows: int = DEFAULT_CHUNK_ROWS,
+    filtered: bool = True,
+    workers: Optional[int] = None,
+) -> Tuple[np.ndarray, np.ndarray]:
+    """
+    Load an external EEG dataset and return (X, y).
 
-    return X, labels_norm
+    This implementation expects:
+        - All columns starting with "voltage_" are raw EEG samples
+        - A column named "label" with values in {0,1,2} or {"Relaxed",...}
 
+    The CSV is read in chunks of `chunk_rows` segments (see
+    `iter_dataset_chunks`), so only the feature matrix has to fit in RAM.
 
-def train_model(data_path: str) -> None:
-    X, y = load_dataset(data_path)
+    Adapt this function if your dataset has a different structure.
+    """
+    parts = list(iter_dataset_chunks(path, chunk_rows, filtered, workers))
+    if not parts:
+        return np.zeros((0, N_FEATURES), dtype=float), np.zeros(0, dtype=int)
+    X = np.concatenate([p[0] for p in parts], axis=0)
+    y = np.concatenate([p[1] for p in parts], axis=0)
+    return X, y
+
+
+def _parse_label(label: str) -> int:
+    label = label.strip().lower()
+    if label.isdigit():
+        return int(label)
+    return CLASS_MAP_STR_TO_INT[label]
+
+
+def load_recordings(
+    specs: Sequence[str],
+    window_seconds: float = 3.0,
+    chunk_rows: int = DEFAULT_CHUNK_ROWS,
+    cache_dir: Optional[str] = None,
+    filtered: bool = True,
+) -> Tuple[np.ndarray, np.ndarray]:
+    """
+    Build (X, y) from whole labelled recordings.
+
+    Each spec is "label=path"; the recording is opened with
+    `open_recording` (memory-mapped for .eegrec) and cut into
+    non-overlapping windows that are featurized `chunk_rows` windows at
+    a time straight from the map. With `filtered` the recording is run
+    continuously through a StreamingFilter first, as it was live. All
+    recordings must have the same channel count (the same feature width).
+    """
+    feats: List[np.ndarray] = []
+    labels: List[int] = []
+    for spec in specs:
+        if "=" not in spec:
+            raise ValueError(f"Recording must be given as label=path, got {spec!r}")
+        label_str, path = spec.split("=", 1)
+        label = _parse_label(label_str)
+
+        X_rec = cached_features(
+            path,
+            {
+                "kind": "recording",
+                "window_seconds": window_seconds,
+                "filter": _filter_config(filtered),
+            },
+            lambda: _featurize_recording(path, window_seconds, chunk_rows, filtered),
+            cache_dir,
+        )
+        if X_rec.shape[0] == 0:
+            print(f"[WARN] {path} is shorter than one window, skipped")
+            continue
+        if feats and X_rec.shape[1] != feats[0].shape[1]:
+            raise ValueError(
+                f"{path} has {X_rec.shape[1] // N_FEATURES} channel(s) but earlier "
+                f"recordings have {feats[0].shape[1] // N_FEATURES}; "
+                "train on recordings with the same channel count"
+            )
+        feats.append(np.asarray(X_rec))
+        labels.extend([label] * X_rec.shape[0])
+
+    if not feats:
+        raise ValueError("No training windows found in the given recordings.")
+    return np.concatenate(feats, axis=0), np.array(labels, dtype=int)
+
+
+def _featurize_recording(
+    path: str,
+    window_seconds: float,
+    chunk_rows: int,
+    filtered: bool = True,
+) -> np.ndarray:
+    rec = open_recording(path)
+    window = int(window_seconds * rec.fs)
+    n_windows = len(rec) // window
+    channels = rec.channels
+    filt = None
+    if filtered:
+        filt = StreamingFilter(rec.fs, channels=channels if channels > 1 else None)
+    X = np.zeros((n_windows, channels * N_FEATURES), dtype=float)
+    for i in range(0, n_windows, chunk_rows):
+        j = min(i + chunk_rows, n_windows)
+        block = np.asarray(rec.voltage[i * window : j * window])
+        if filt is not None:
+            block = filt.process(block)
+        if channels == 1:
+            X[i:j] = extract_features_batch(block.reshape(j - i, window), fs=rec.fs)
+        else:
+            # (samples, channels) -> (windows, channels, window)
+            segments = block.reshape(j - i, window, channels).transpose(0, 2, 1)
+            X[i:j] = extract_features_multichannel(segments, fs=rec.fs)
+    return X
+
+
+def _filter_config(filtered: bool) -> Optional[Dict[str, Any]]:
+    if not filtered:
+        return None
+    return {"mains": MAINS_HZ, "band": list(BANDPASS_HZ)}
+
+
+# ---------------- feature cache ----------------
+def _feature_config(extra: Dict[str, Any]) -> Dict[str, Any]:
+    """Everything that changes the feature values, for the cache key."""
+    return {
+        "version": FEATURE_CACHE_VERSION,
+        "fs": DEFAULT_FS,
+        "bands": [list(band) for _name, band in BANDS],
+        "n_features": N_FEATURES,
+        **extra,
+    }
+
+
+def cached_features(
+    path: str,
+    extra_config: Dict[str, Any],
+    compute: Callable[[], Any],
+    cache_dir: Optional[str],
+) -> Any:
+    """
+    Return compute() for `path`, reusing a copy cached in `cache_dir`.
 
+    The key combines the SHA-256 of the dataset file with the feature
+    configuration, so editing either one invalidates the entry. Arrays
+    are stored as .npy and reopened memory-mapped. With cache_dir None
+    this just calls compute().
+    """
+    if not cache_dir:
+        return compute()
+
+    config = json.dumps(_feature_config(extra_config), sort_keys=True)
+    key = hashlib.sha256((file_sha256(path) + config).encode()).hexdigest()[:20]
+    stem = os.path.join(cache_dir, f"{os.path.basename(path)}.{key}")
+
+    names = ("X", "y") if extra_config.get("kind") == "dataset" else ("X",)
+    files = [f"{stem}.{name}.npy" for name in names]
+    if all(os.path.exists(f) for f in files):
+        print(f"[INFO] Using cached features for {path}")
+        arrays = [np.load(f, mmap_mode="r") for f in files]
+        return tuple(arrays) if len(arrays) > 1 else arrays[0]
+
+    result = compute()
+    arrays = result if isinstance(result, tuple) else (result,)
+    os.makedirs(cache_dir, exist_ok=True)
+    for f, arr in zip(files, arrays):
+        # Write then rename so an interrupted run never leaves a bad entry
+        tmp = f + ".tmp.npy"
+        np.save(tmp, arr)
+        os.replace(tmp, f)
+    return result
+
+
+def train_model(X: np.ndarray, y: np.ndarray) -> None:
     X_train, X_test, y_train, y_test = train_test_split(
         X,
         y,
@@ -126,6 +366,214 @@ def train_model(data_path: str) -> None:
     joblib.dump(clf, MODEL_PATH)
     print(f"Saved trained model to {MODEL_PATH}")
 
+    # Flat node arrays for the GUI's low-latency single-window path
+    forest = flatten_forest(clf)
+    forest.save(FOREST_PATH)
+    print(f"Exported flattened forest ({forest.n_nodes} nodes) to {FOREST_PATH}")
+
+
+# ---------------- model search ----------------
+LATENCY_CALLS = 300  # single-window predictions timed per candidate
+
+
+def search_candidates() -> Dict[str, Any]:
+    """Unfitted models tried by --search, by name."""
+    candidates: Dict[str, Any] = {}
+    for n in (25, 50, 100, 200):
+        for depth in (6, 12, None):
+            candidates[f"forest_{n}_d{depth or 'max'}"] = RandomForestClassifier(
+                n_estimators=n, max_depth=depth, random_state=42, n_jobs=1
+            )
+    candidates["tree_d6"] = DecisionTreeClassifier(max_depth=6, random_state=42)
+    for iters in (50, 150):
+        candidates[f"hgb_{iters}"] = HistGradientBoostingClassifier(
+            max_iter=iters, max_depth=4, random_state=42
+        )
+    candidates["logreg_bands"] = make_pipeline(
+        FunctionTransformer(log_band_powers),
+        StandardScaler(),
+        LogisticRegression(max_iter=1000),
+    )
+    return candidates
+
+
+def _fold_accuracy(
+    model: Any,
+    X: np.ndarray,
+    y: np.ndarray,
+    train: np.ndarray,
+    test: np.ndarray,
+) -> float:
+    model = clone(model).fit(X[train], y[train])
+    return float(np.mean(model.predict(X[test]) == y[test]))
+
+
+def _fit(model: Any, X: np.ndarray, y: np.ndarray) -> Any:
+    return clone(model).fit(X, y)
+
+
+def _inference_model(model: Any) -> Any:
+    """What the GUI predicts with: forests are flattened, others as-is."""
+    if isinstance(model, RandomForestClassifier):
+        return flatten_forest(model)
+    return model
+
+
+def measure_latency(model: Any, X: np.ndarray, calls: int = LATENCY_CALLS) -> Dict[str, float]:
+    """Single-window predict_proba latency quantiles, in milliseconds."""
+    rows = np.asarray(X[: min(len(X), 64)], dtype=float)
+    model.predict_proba(rows[:1])  # warm-up
+    times = np.empty(calls)
+    for i in range(calls):
+        row = rows[i % len(rows)][None, :]
+        t0 = time.perf_counter()
+        model.predict_proba(row)
+        times[i] = time.perf_counter() - t0
+    ms = 1e3 * times
+    return {
+        "p50_ms": float(np.percentile(ms, 50)),
+        "p99_ms": float(np.percentile(ms, 99)),
+        "max_ms": float(ms.max()),
+    }
+
+
+def _reload_error(path: str) -> Optional[str]:
+    """
+    Load a pickled model in a fresh interpreter, as the GUI would.
+
+    Returns the error output, or None when it loads. A fresh process
+    catches references (e.g. to functions in __main__) that only resolve
+    inside this script.
+    """
+    code = "import sys, joblib; joblib.load(sys.argv[1])"
+    proc = subprocess.run(
+        [sys.executable, "-c", code, os.path.abspath(path)],
+        cwd=os.path.dirname(os.path.abspath(__file__)),
+        capture_output=True,
+        text=True,
+    )
+    if proc.returncode == 0:
+        return None
+    lines = proc.stderr.strip().splitlines()
+    return lines[-1] if lines else f"exit status {proc.returncode}"
+
+
+def pareto_front(scores: Dict[str, Dict[str, float]]) -> List[str]:
+    """Candidates no other candidate beats on both accuracy and p99 latency."""
+    front = []
+    for name, s in scores.items():
+        dominated = any(
+            o["accuracy"] >= s["accuracy"]
+            and o["p99_ms"] <= s["p99_ms"]
+            and (o["accuracy"] > s["accuracy"] or o["p99_ms"] < s["p99_ms"])
+            for other, o in scores.items()
+            if other != name
+        )
+        if not dominated:
+            front.append(name)
+    return sorted(front, key=lambda n: scores[n]["p99_ms"])
+
+
+def search_models(
+    X: np.ndarray,
+    y: np.ndarray,
+    folds: int = 5,
+    n_jobs: int = -1,
+    latency_budget_ms: Optional[float] = None,
+) -> None:
+    """
+    Cross-validate every candidate in parallel, time it, save the pick.
+
+    The (candidate, fold) fits run on a joblib process pool; X is
+    memory-mapped from disk first, so workers share one copy instead of
+    each receiving a pickled matrix. Latency is measured afterwards, one
+    candidate at a time, on the model as the GUI would run it (forests
+    flattened to eeg_forest.FlatForest).
+    """
+    candidates = search_candidates()
+    names = list(candidates)
+    splits = list(StratifiedKFold(folds, shuffle=True, random_state=42).split(X, y))
+
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, "X.npy")
+        np.save(path, np.asarray(X, dtype=float))
+        Xm = np.load(path, mmap_mode="r")
+        print(f"[INFO] Searching {len(names)} candidates x {folds} folds on {Xm.shape[0]} windows")
+
+        t0 = time.perf_counter()
+        parallel = Parallel(n_jobs=n_jobs)
+        accs = parallel(
+            delayed(_fold_accuracy)(candidates[name], Xm, y, train, test)
+            for name in names
+            for train, test in splits
+        )
+        fitted = parallel(delayed(_fit)(candidates[name], Xm, y) for name in names)
+        print(f"[INFO] Cross-validation and refits took {time.perf_counter() - t0:.1f} s")
+
+        scores: Dict[str, Dict[str, float]] = {}
+        for i, name in enumerate(names):
+            fold_accs = np.asarray(accs[i * folds : (i + 1) * folds])
+            scores[name] = {
+                "accuracy": float(fold_accs.mean()),
+                "accuracy_std": float(fold_accs.std()),
+                **measure_latency(_inference_model(fitted[i]), Xm),
+            }
+
+    front = pareto_front(scores)
+    allowed = [
+        n for n in front if latency_budget_ms is None or scores[n]["p99_ms"] <= latency_budget_ms
+    ]
+    if not allowed:
+        print(
+            f"[WARN] No candidate meets the {latency_budget_ms} ms budget; "
+            "keeping the fastest one"
+        )
+        allowed = front[:1]
+    best = max(allowed, key=lambda n: (scores[n]["accuracy"], -scores[n]["p99_ms"]))
+
+    print(f"{'candidate':<22} {'accuracy':>14} {'p50 ms':>9} {'p99 ms':>9}")
+    for name in sorted(names, key=lambda n: -scores[n]["accuracy"]):
+        s = scores[name]
+        mark = " *" if name == best else (" pareto" if name in front else "")
+        print(
+            f"{name:<22} {s['accuracy']:8.3f}+-{s['accuracy_std']:.3f} "
+            f"{s['p50_ms']:9.3f} {s['p99_ms']:9.3f}{mark}"
+        )
+
+    model = fitted[names.index(best)]
+    os.makedirs(MODEL_DIR, exist_ok=True)
+    # Only replace the current model once the new pickle loads elsewhere
+    tmp = MODEL_PATH + ".tmp"
+    joblib.dump(model, tmp)
+    error = _reload_error(tmp)
+    if error:
+        os.remove(tmp)
+        raise SystemExit(f"[ERROR] {best} does not reload ({error}); kept the old model")
+    os.replace(tmp, MODEL_PATH)
+    print(f"[INFO] Saved {best} to {MODEL_PATH}")
+    if isinstance(model, RandomForestClassifier):
+        forest = flatten_forest(model)
+        forest.save(FOREST_PATH)
+        print(f"Exported flattened forest ({forest.n_nodes} nodes) to {FOREST_PATH}")
+    elif os.path.exists(FOREST_PATH):
+        # The GUI prefers the flat forest; a stale one would shadow the pick
+        os.remove(FOREST_PATH)
+        print(f"[INFO] Removed {FOREST_PATH}; {best} is not a forest")
+
+    with open(PROFILE_PATH, "w", encoding="utf-8") as f:
+        json.dump(
+            {
+                "selected": best,
+                "folds": folds,
+                "latency_budget_ms": latency_budget_ms,
+                "pareto": front,
+                "candidates": scores,
+            },
+            f,
+            indent=2,
+        )
+    print(f"[INFO] Wrote latency profile to {PROFILE_PATH}")
+
 
 def main() -> None:
     parser = argparse.ArgumentParser(
@@ -133,12 +581,100 @@ def main() -> None:
     )
     parser.add_argument(
         "--data",
-        required=True,
         help="Path to EEG dataset CSV file.",
     )
+    parser.add_argument(
+        "--recording",
+        action="append",
+        default=[],
+        metavar="LABEL=PATH",
+        help="Labelled recording (.eegrec or CSV log); may be repeated.",
+    )
+    parser.add_argument(
+        "--window-seconds",
+        type=float,
+        default=3.0,
+        help="Window length used to segment --recording inputs.",
+    )
+    parser.add_argument(
+        "--chunk-rows",
+        type=int,
+        default=DEFAULT_CHUNK_ROWS,
+        help="Segments read and featurized per chunk (bounds memory use).",
+    )
+    parser.add_argument(
+        "--cache-features",
+        nargs="?",
+        const=FEATURE_CACHE_DIR,
+        default=None,
+        metavar="DIR",
+        help=f"Cache computed features (default dir: {FEATURE_CACHE_DIR}) "
+        "keyed by file hash and feature config.",
+    )
+    parser.add_argument(
+        "--no-filter",
+        action="store_true",
+        help="Skip the notch + bandpass stage (only if the GUI runs with "
+        "LIVE_FILTER = False).",
+    )
+    parser.add_argument(
+        "--search",
+        action="store_true",
+        help="Cross-validated model search scored on accuracy and latency "
+        "(implies --cache-features).",
+    )
+    parser.add_argument("--folds", type=int, default=5, help="Cross-validation folds for --search.")
+    parser.add_argument(
+        "--jobs", type=int, default=-1, help="Parallel fits for --search (-1 = all cores)."
+    )
+    parser.add_argument(
+        "--latency-budget-ms",
+        type=float,
+        default=None,
+        help="Only pick models whose p99 single-window latency fits this budget.",
+    )
     args = parser.parse_args()
 
-    train_model(args.data)
+    if not args.data and not args.recording:
+        parser.error("give --data and/or at least one --recording")
+    if args.search and args.cache_features is None:
+        # Experiments repeat; featurize each input only once
+        args.cache_features = FEATURE_CACHE_DIR
+
+    parts = []
+    if args.data:
+        parts.append(
+            cached_features(
+                args.data,
+                {"kind": "dataset", "filter": _filter_config(not args.no_filter)},
+                lambda: load_dataset(args.data, args.chunk_rows, not args.no_filter),
+                args.cache_features,
+            )
+        )
+    if args.recording:
+        parts.append(
+            load_recordings(
+                args.recording,
+                args.window_seconds,
+                args.chunk_rows,
+                args.cache_features,
+                not args.no_filter,
+            )
+        )
+    widths = [np.asarray(p[0]).shape[1] for p in parts]
+    if len(set(widths)) > 1:
+        parser.error(
+            f"--data is single-channel ({widths[0]} features per window) but "
+            f"--recording has {widths[1] // N_FEATURES} channels ({widths[1]} features); "
+            "train them separately"
+        )
+    X = np.concatenate([np.asarray(p[0]) for p in parts], axis=0)
+    y = np.concatenate([np.asarray(p[1]) for p in parts], axis=0)
+
+    if args.search:
+        search_models(X, y, args.folds, args.jobs, args.latency_budget_ms)
+    else:
+        train_model(X, y)
 
 
 if __name__ == "__main__":